@@ -1631,10 +1631,8 @@ GeneratedOutput generate_output(const ir::Program& program,
     
     // Emit init and run functions
     source_ss << "void " << options.output_prefix << "_init(GBContext* ctx) {\n";
-    source_ss << "    /* Load ROM data into context */\n";
+    source_ss << "    /* Load ROM data into context (sets MBC type and cartridge RAM from the header) */\n";
     source_ss << "    gb_context_load_rom(ctx, rom_data, " << rom_size << ");\n";
-    source_ss << "    /* Set MBC type from header */\n";
-    source_ss << "    ctx->mbc_type = rom_data[0x147];\n";
     source_ss << "}\n\n";
     
     source_ss << "void " << options.output_prefix << "_run(GBContext* ctx) {\n";
@@ -1669,15 +1667,40 @@ GeneratedOutput generate_output(const ir::Program& program,
     main_ss << "/* Main entry point */\n";
     main_ss << "#include \"" << options.output_prefix << ".h\"\n";
     main_ss << "#include \"gbrt.h\"\n";
-    main_ss << "#ifdef GB_HAS_SDL2\n";
     main_ss << "#include \"platform_sdl.h\"\n";
-    main_ss << "#endif\n";
+    main_ss << "#include \"platform_headless.h\"\n";
+    main_ss << "#include \"platform_shm.h\"\n";
+    main_ss << "#include \"savestate.h\"\n";
     main_ss << "#include <stdio.h>\n";
     main_ss << "#include <stdio.h>\n";
     main_ss << "#include <stdlib.h>\n";
     main_ss << "#include <string.h>\n\n";
     main_ss << "int main(int argc, char* argv[]) {\n";
     main_ss << "    // Parse args\n";
+    main_ss << "    uint32_t overclock_percent = 100;\n";
+    main_ss << "    bool render_thread = false;\n";
+    main_ss << "    bool audio_thread = false;\n";
+    main_ss << "    bool headless = false;\n";
+    main_ss << "    unsigned skip = 0, skip_period = 0;\n";
+    main_ss << "    const char* video_out = NULL;\n";
+    main_ss << "    const char* audio_out = NULL;\n";
+    main_ss << "    const char* shm_name = NULL;\n";
+    main_ss << "    const char* input_socket = NULL;\n";
+    main_ss << "    const char* save_path = NULL;\n";
+    main_ss << "    const char* load_state = NULL;\n";
+    main_ss << "    const char* save_state = NULL;\n";
+    main_ss << "    unsigned run_ahead = 0;\n";
+    main_ss << "    GBScaleFilter scale_filter = GB_SCALE_NONE;\n";
+    main_ss << "    unsigned long long max_frames = 0;\n";
+    main_ss << "#ifdef GB_HAS_SDL2\n";
+    main_ss << "    // Settings of the SDL2 window only\n";
+    main_ss << "    bool auto_frameskip = false;\n";
+    main_ss << "    GBPacingMode pacing = GB_PACING_AUDIO;\n";
+    main_ss << "    bool present_thread = false;\n";
+    main_ss << "    GBCaptureFormat capture_format = GB_CAPTURE_PPM;\n";
+    main_ss << "    GBCapturePolicy capture_policy = GB_CAPTURE_BLOCK;\n";
+    main_ss << "    unsigned rewind_mb = 0;\n";
+    main_ss << "#endif\n";
     main_ss << "    for (int i = 1; i < argc; i++) {\n";
     main_ss << "        if (strcmp(argv[i], \"--trace\") == 0) {\n";
     main_ss << "            gbrt_trace_enabled = true;\n";
@@ -1693,16 +1716,160 @@ GeneratedOutput generate_output(const ir::Program& program,
     main_ss << "            gb_platform_set_dump_frames(argv[++i]);\n";
     main_ss << "        } else if (strcmp(argv[i], \"--screenshot-prefix\") == 0 && i + 1 < argc) {\n";
     main_ss << "            gb_platform_set_screenshot_prefix(argv[++i]);\n";
+    main_ss << "        } else if (strcmp(argv[i], \"--overclock\") == 0 && i + 1 < argc) {\n";
+    main_ss << "            overclock_percent = (uint32_t)strtoul(argv[++i], NULL, 10);\n";
+    main_ss << "        } else if (strcmp(argv[i], \"--render-thread\") == 0) {\n";
+    main_ss << "            render_thread = true;\n";
+    main_ss << "        } else if (strcmp(argv[i], \"--audio-thread\") == 0) {\n";
+    main_ss << "            audio_thread = true;\n";
+    main_ss << "        } else if (strcmp(argv[i], \"--frameskip\") == 0 && i + 1 < argc) {\n";
+    main_ss << "            const char* arg = argv[++i];\n";
+    main_ss << "            if (strcmp(arg, \"auto\") == 0) {\n";
+    main_ss << "#ifdef GB_HAS_SDL2\n";
+    main_ss << "                auto_frameskip = true;\n";
+    main_ss << "#endif\n";
+    main_ss << "            } else if (sscanf(arg, \"%u/%u\", &skip, &skip_period) == 1) {\n";
+    main_ss << "                skip_period = skip + 1;\n";
+    main_ss << "            }\n";
+    main_ss << "#ifdef GB_HAS_SDL2\n";
+    main_ss << "        } else if (strcmp(argv[i], \"--pacing\") == 0 && i + 1 < argc) {\n";
+    main_ss << "            pacing = strcmp(argv[++i], \"vsync\") == 0 ? GB_PACING_VSYNC : GB_PACING_AUDIO;\n";
+    main_ss << "        } else if (strcmp(argv[i], \"--present-thread\") == 0) {\n";
+    main_ss << "            present_thread = true;\n";
+    main_ss << "#endif\n";
+    main_ss << "        } else if (strcmp(argv[i], \"--video-out\") == 0 && i + 1 < argc) {\n";
+    main_ss << "            video_out = argv[++i];\n";
+    main_ss << "        } else if (strcmp(argv[i], \"--audio-out\") == 0 && i + 1 < argc) {\n";
+    main_ss << "            audio_out = argv[++i];\n";
+    main_ss << "#ifdef GB_HAS_SDL2\n";
+    main_ss << "        } else if (strcmp(argv[i], \"--capture-format\") == 0 && i + 1 < argc) {\n";
+    main_ss << "            capture_format = strcmp(argv[++i], \"png\") == 0 ? GB_CAPTURE_PNG : GB_CAPTURE_PPM;\n";
+    main_ss << "        } else if (strcmp(argv[i], \"--capture-policy\") == 0 && i + 1 < argc) {\n";
+    main_ss << "            capture_policy = strcmp(argv[++i], \"drop\") == 0 ? GB_CAPTURE_DROP : GB_CAPTURE_BLOCK;\n";
+    main_ss << "#endif\n";
+    main_ss << "        } else if (strcmp(argv[i], \"--shm\") == 0 && i + 1 < argc) {\n";
+    main_ss << "            shm_name = argv[++i];\n";
+    main_ss << "        } else if (strcmp(argv[i], \"--input-socket\") == 0 && i + 1 < argc) {\n";
+    main_ss << "            input_socket = argv[++i];\n";
+    main_ss << "        } else if (strcmp(argv[i], \"--scale-filter\") == 0 && i + 1 < argc) {\n";
+    main_ss << "            const char* arg = argv[++i];\n";
+    main_ss << "            if (strcmp(arg, \"2x\") == 0) scale_filter = GB_SCALE_2X;\n";
+    main_ss << "            else if (strcmp(arg, \"3x\") == 0) scale_filter = GB_SCALE_3X;\n";
+    main_ss << "            else if (strcmp(arg, \"4x\") == 0) scale_filter = GB_SCALE_4X;\n";
+    main_ss << "            else if (strcmp(arg, \"scale2x\") == 0) scale_filter = GB_SCALE_SCALE2X;\n";
+    main_ss << "            else scale_filter = GB_SCALE_NONE;\n";
+    main_ss << "        } else if (strcmp(argv[i], \"--save\") == 0 && i + 1 < argc) {\n";
+    main_ss << "            save_path = argv[++i];\n";
+    main_ss << "        } else if (strcmp(argv[i], \"--load-state\") == 0 && i + 1 < argc) {\n";
+    main_ss << "            load_state = argv[++i];\n";
+    main_ss << "        } else if (strcmp(argv[i], \"--save-state\") == 0 && i + 1 < argc) {\n";
+    main_ss << "            save_state = argv[++i];\n";
+    main_ss << "#ifdef GB_HAS_SDL2\n";
+    main_ss << "        } else if (strcmp(argv[i], \"--rewind\") == 0 && i + 1 < argc) {\n";
+    main_ss << "            rewind_mb = (unsigned)strtoul(argv[++i], NULL, 10);\n";
+    main_ss << "#else\n";
+    main_ss << "        } else if (strcmp(argv[i], \"--rewind\") == 0 && i + 1 < argc) {\n";
+    main_ss << "            i++;\n";
+    main_ss << "            fprintf(stderr, \"--rewind needs the SDL2 window; ignoring it\\n\");\n";
+    main_ss << "#endif\n";
+    main_ss << "        } else if (strcmp(argv[i], \"--run-ahead\") == 0 && i + 1 < argc) {\n";
+    main_ss << "            run_ahead = (unsigned)strtoul(argv[++i], NULL, 10);\n";
+    main_ss << "        } else if (strcmp(argv[i], \"--frames\") == 0 && i + 1 < argc) {\n";
+    main_ss << "            max_frames = strtoull(argv[++i], NULL, 10);\n";
+    main_ss << "        } else if (strcmp(argv[i], \"--headless\") == 0) {\n";
+    main_ss << "            headless = true;\n";
     main_ss << "        }\n";
-    main_ss << "    }\n\n";
+    main_ss << "    }\n";
+    main_ss << "#ifdef GB_HAS_SDL2\n";
+    main_ss << "    if (rewind_mb && (video_out || audio_out || shm_name || headless)) {\n";
+    main_ss << "        fprintf(stderr, \"--rewind needs the SDL2 window; ignoring it\\n\");\n";
+    main_ss << "    }\n";
+    main_ss << "#endif\n\n";
     main_ss << "    GBContext* ctx = gb_context_create(NULL);\n";
     main_ss << "    if (!ctx) {\n";
     main_ss << "        fprintf(stderr, \"Failed to create context\\n\");\n";
     main_ss << "        return 1;\n";
     main_ss << "    }\n";
     main_ss << "    " << options.output_prefix << "_init(ctx);\n";
+    main_ss << "    // Cartridges without RAM have nothing to save\n";
+    main_ss << "    if (save_path && ctx->eram && !gb_context_attach_save(ctx, save_path)) {\n";
+    main_ss << "        fprintf(stderr, \"Cannot use save file %s\\n\", save_path);\n";
+    main_ss << "        gb_context_destroy(ctx);\n";
+    main_ss << "        return 1;\n";
+    main_ss << "    }\n";
+    main_ss << "    if (load_state && !gb_state_load_file(ctx, load_state)) {\n";
+    main_ss << "        gb_context_destroy(ctx);\n";
+    main_ss << "        return 1;\n";
+    main_ss << "    }\n";
+    main_ss << "    gb_set_cpu_overclock(ctx, overclock_percent);\n";
+    main_ss << "    if (render_thread) gb_set_deferred_rendering(ctx, true);\n";
+    main_ss << "    if (audio_thread) gb_set_audio_thread(ctx, true);\n";
+    main_ss << "    gb_set_frameskip(ctx, skip, skip_period);\n";
+    main_ss << "    if (run_ahead && !gb_set_run_ahead(ctx, run_ahead)) {\n";
+    main_ss << "        fprintf(stderr, \"Cannot enable run-ahead\\n\");\n";
+    main_ss << "    }\n";
+    main_ss << "\n";
+    main_ss << "    if (video_out || audio_out) {\n";
+    main_ss << "        // Capture: stream video/audio to files or pipes as fast as\n";
+    main_ss << "        // possible, with no window and no SDL.\n";
+    main_ss << "        GBHeadlessConfig capture = {0};\n";
+    main_ss << "        capture.video_path = video_out;\n";
+    main_ss << "        capture.audio_path = audio_out;\n";
+    main_ss << "        if (!gb_headless_init(ctx, &capture)) {\n";
+    main_ss << "            gb_context_destroy(ctx);\n";
+    main_ss << "            return 1;\n";
+    main_ss << "        }\n";
+    main_ss << "        if (!video_out) gb_set_headless(ctx, true);\n";
+    main_ss << "        for (unsigned long long frame = 0; !max_frames || frame < max_frames; frame++) {\n";
+    main_ss << "            gb_run_frame(ctx);\n";
+    main_ss << "            gb_headless_submit_frame(ctx);\n";
+    main_ss << "            ctx->stopped = 0;\n";
+    main_ss << "        }\n";
+    main_ss << "        if (save_state) gb_state_save_file(ctx, save_state);\n";
+    main_ss << "        gb_headless_shutdown();\n";
+    main_ss << "        gb_context_destroy(ctx);\n";
+    main_ss << "        return 0;\n";
+    main_ss << "    }\n";
+    main_ss << "\n";
+    main_ss << "    if (shm_name) {\n";
+    main_ss << "        // Streaming: publish frames and audio into shared memory in\n";
+    main_ss << "        // real time, taking input from a Unix socket. No window or SDL.\n";
+    main_ss << "        GBShmConfig stream = {0};\n";
+    main_ss << "        stream.name = shm_name;\n";
+    main_ss << "        stream.input_socket = input_socket;\n";
+    main_ss << "        stream.scale = scale_filter;\n";
+    main_ss << "        if (!gb_shm_init(ctx, &stream)) {\n";
+    main_ss << "            gb_context_destroy(ctx);\n";
+    main_ss << "            return 1;\n";
+    main_ss << "        }\n";
+    main_ss << "        for (unsigned long long frame = 0; !max_frames || frame < max_frames; frame++) {\n";
+    main_ss << "            gb_run_frame(ctx);\n";
+    main_ss << "            gb_shm_submit_frame(ctx);\n";
+    main_ss << "            ctx->stopped = 0;\n";
+    main_ss << "        }\n";
+    main_ss << "        if (save_state) gb_state_save_file(ctx, save_state);\n";
+    main_ss << "        gb_shm_shutdown();\n";
+    main_ss << "        gb_context_destroy(ctx);\n";
+    main_ss << "        return 0;\n";
+    main_ss << "    }\n";
+    main_ss << "\n";
+    main_ss << "    if (headless) {\n";
+    main_ss << "        // Timing only: no window, no rasterization, no frame pacing.\n";
+    main_ss << "        // Runs until --limit or --frames is reached.\n";
+    main_ss << "        gb_set_headless(ctx, true);\n";
+    main_ss << "        for (unsigned long long frame = 0; !max_frames || frame < max_frames; frame++) {\n";
+    main_ss << "            gb_run_frame(ctx);\n";
+    main_ss << "            ctx->stopped = 0;\n";
+    main_ss << "        }\n";
+    main_ss << "        if (save_state) gb_state_save_file(ctx, save_state);\n";
+    main_ss << "        gb_context_destroy(ctx);\n";
+    main_ss << "        return 0;\n";
+    main_ss << "    }\n";
     main_ss << "\n";
     main_ss << "#ifdef GB_HAS_SDL2\n";
+    main_ss << "    gb_platform_set_pacing(pacing);\n";
+    main_ss << "    gb_platform_set_capture(capture_format, capture_policy);\n";
+    main_ss << "    gb_platform_set_present_thread(present_thread);\n";
     main_ss << "    // Initialize SDL2 platform with 3x scaling\n";
     main_ss << "    if (!gb_platform_init(3)) {\n";
     main_ss << "        fprintf(stderr, \"Failed to initialize platform\\n\");\n";
@@ -1710,10 +1877,16 @@ GeneratedOutput generate_output(const ir::Program& program,
     main_ss << "        return 1;\n";
     main_ss << "    }\n";
     main_ss << "    gb_platform_register_context(ctx);\n";
+    main_ss << "    gb_platform_set_auto_frameskip(auto_frameskip);\n";
+    main_ss << "    GBRewind* rewind = rewind_mb ? gb_rewind_create(ctx, (size_t)rewind_mb << 20, 0) : NULL;\n";
     main_ss << "\n";
     main_ss << "    // Run the game loop\n";
     main_ss << "    while (1) {\n";
-    main_ss << "        gb_run_frame(ctx);\n";
+    main_ss << "        // While rewinding, show one recorded frame per frame instead of running\n";
+    main_ss << "        if (!(rewind && gb_platform_rewind_held() && gb_rewind_pop(rewind, ctx))) {\n";
+    main_ss << "            gb_run_frame(ctx);\n";
+    main_ss << "            if (rewind) gb_rewind_push(rewind, ctx);\n";
+    main_ss << "        }\n";
     main_ss << "        if (!gb_platform_poll_events(ctx)) break;\n";
     main_ss << "        if (ctx->frame_done) {\n";
     main_ss << "            const uint32_t* fb = gb_get_framebuffer(ctx);\n";
@@ -1723,6 +1896,8 @@ GeneratedOutput generate_output(const ir::Program& program,
     main_ss << "            gb_platform_vsync();\n";
     main_ss << "        }\n";
     main_ss << "    }\n";
+    main_ss << "    if (save_state) gb_state_save_file(ctx, save_state);\n";
+    main_ss << "    gb_rewind_destroy(rewind);\n";
     main_ss << "    gb_platform_shutdown();\n";
     main_ss << "#else\n";
     main_ss << "    // No SDL2 - just run for testing\n";
@@ -1774,9 +1949,16 @@ GeneratedOutput generate_output(const ir::Program& program,
     cmake_ss << "    ${GBRT_DIR}/src/audio.c\n";
     cmake_ss << "    ${GBRT_DIR}/src/interpreter.c\n";
     cmake_ss << "    ${GBRT_DIR}/src/platform_sdl.c\n";
+    cmake_ss << "    ${GBRT_DIR}/src/platform_headless.c\n";
+    cmake_ss << "    ${GBRT_DIR}/src/platform_shm.c\n";
+    cmake_ss << "    ${GBRT_DIR}/src/savestate.c\n";
     cmake_ss << ")\n";
     cmake_ss << "target_include_directories(gbrt PUBLIC ${GBRT_DIR}/include)\n";
-    cmake_ss << "target_link_libraries(gbrt PUBLIC SDL2::SDL2)\n";
+    cmake_ss << "find_package(Threads REQUIRED)\n";
+    cmake_ss << "target_link_libraries(gbrt PUBLIC SDL2::SDL2 Threads::Threads)\n";
+    cmake_ss << "if(UNIX)\n    target_link_libraries(gbrt PUBLIC m)\nendif()\n";
+    cmake_ss << "find_library(RT_LIBRARY rt)\n";
+    cmake_ss << "if(RT_LIBRARY)\n    target_link_libraries(gbrt PUBLIC ${RT_LIBRARY})\nendif()\n";
     cmake_ss << "target_compile_definitions(gbrt PUBLIC GB_HAS_SDL2)\n\n";
     cmake_ss << "# Main executable\n";
     cmake_ss << "add_executable(" << options.output_prefix << "\n";
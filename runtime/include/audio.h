@@ -42,14 +42,56 @@ uint8_t gb_audio_read(GBContext* ctx, uint16_t addr);
 void gb_audio_write(GBContext* ctx, uint16_t addr, uint8_t value);
 
 /**
- * @brief Step audio subsystem
+ * @brief Render audio up to the CPU's current cycle count
+ *
+ * Called lazily on sound register access and DIV reset; nothing runs per
+ * instruction.
  */
-void gb_audio_step(GBContext* ctx, uint32_t cycles);
+void gb_audio_sync(GBContext* ctx);
+
+/**
+ * @brief Catch up and deliver everything rendered so far (end of frame)
+ */
+void gb_audio_end_frame(GBContext* ctx);
+
+/**
+ * @brief Set the output block samples are rendered into
+ * @param samples Interleaved frames, or NULL for the internal block
+ * @param frames  Capacity in frames
+ */
+void gb_audio_set_buffer(GBContext* ctx, void* samples, size_t frames);
+
+/**
+ * @brief Set output rate, sample format and channel count
+ *
+ * Output is band-limited synthesis at the exact requested rate. A
+ * caller-owned block set with gb_audio_set_buffer must match the format.
+ */
+bool gb_audio_set_format(GBContext* ctx, uint32_t sample_rate, GBSampleFormat format, int channels);
+
+/**
+ * @brief Enable or disable the output high-pass (DC blocking) filter
+ */
+void gb_audio_set_highpass(GBContext* ctx, bool enabled);
 
 /**
  * @brief Reset Frame Sequencer (called on DIV write)
  */
-void gb_audio_div_reset(void* apu);
+void gb_audio_div_reset(GBContext* ctx);
+
+/**
+ * @brief Move APU rendering to a worker thread fed with timestamped writes
+ * @return false if the thread could not be started
+ */
+bool gb_audio_set_threaded(GBContext* ctx, bool enabled);
+
+/**
+ * @brief Stop synthesizing: only the frame sequencer and register state advance
+ *
+ * Used for frames whose audio is never heard (run-ahead). Leaving silent
+ * mode without loading a state resumes from the current register state.
+ */
+void gb_audio_set_silent(GBContext* ctx, bool silent);
 
 /**
  * @brief Get current sample for left/right channels
@@ -59,12 +59,29 @@ extern uint64_t gbrt_instruction_limit;
  */
 typedef struct GBContext GBContext;
 
+/**
+ * @brief Audio output sample format
+ */
+typedef enum {
+    GB_SAMPLE_S16,  /**< Signed 16-bit integer */
+    GB_SAMPLE_F32   /**< 32-bit float in [-1, 1] */
+} GBSampleFormat;
+
 /**
  * @brief Platform callbacks for I/O and rendering
  */
 typedef struct {
     void (*on_vblank)(GBContext* ctx, const uint8_t* framebuffer);
     void (*on_audio_sample)(GBContext* ctx, int16_t left, int16_t right);
+    /* Preferred over on_audio_sample: a block of interleaved frames in the
+       format set by gb_set_audio_format (default 44100 Hz int16 stereo),
+       delivered when the output block fills and at the end of each frame */
+    void (*on_audio_block)(GBContext* ctx, const void* samples, size_t frames);
+    /* Button state, active low: Start/Select/B/A in bits 7-4 and
+       Down/Up/Left/Right in bits 3-0. When set, it replaces the
+       g_joypad_* globals and is polled lazily on the first JOYP read of
+       each frame (at frame start while the joypad interrupt is enabled);
+       the runtime raises the joypad interrupt on input line edges */
     uint8_t (*get_joypad)(GBContext* ctx);
     void (*on_serial_byte)(GBContext* ctx, uint8_t byte);
 } GBPlatformCallbacks;
@@ -138,6 +155,8 @@ typedef struct GBContext {
     uint32_t frame_cycles;/**< Cycles this frame */
     uint32_t last_sync_cycles; /**< Last cycles count synchronized with hardware */
     uint8_t  frame_done;  /**< Frame is finished and rendered */
+    uint32_t cpu_clock_percent;   /**< CPU overclock (100 = stock, 200 = 2x instructions per frame) */
+    uint32_t cpu_clock_remainder; /**< Fractional CPU cycles not yet charged to hardware */
     
     /* Timer internal state */
     uint16_t div_counter;   /**< Internal 16-bit divider counter */
@@ -145,8 +164,10 @@ typedef struct GBContext {
     /* Memory pointers */
     uint8_t* rom;         /**< ROM data */
     size_t rom_size;
-    uint8_t* eram;        /**< External RAM */
+    uint8_t* eram;        /**< External (cartridge) RAM, sized from the ROM header */
     size_t eram_size;
+    bool eram_mapped;     /**< eram is an mmap of the save file */
+    char* save_path;      /**< Battery save file attached with gb_context_attach_save */
     uint8_t* wram;        /**< Work RAM */
     uint8_t* vram;        /**< Video RAM */
     uint8_t* oam;         /**< Object Attribute Memory */
@@ -168,7 +189,9 @@ typedef struct GBContext {
     void* timer;          /**< Timer unit */
     void* serial;         /**< Serial port */
     void* joypad;         /**< Joypad input */
+    void* run_ahead;      /**< Run-ahead snapshot, NULL when off */
     uint8_t last_joypad;  /**< Last joypad state for interrupt generation */
+    bool joypad_polled;   /**< last_joypad is current for this frame */
     
     /* Platform interface */
     void* platform;       /**< Platform-specific data */
@@ -212,6 +235,22 @@ void gb_context_reset(GBContext* ctx, bool skip_bootrom);
  */
 bool gb_context_load_rom(GBContext* ctx, const uint8_t* data, size_t size);
 
+/**
+ * @brief Whether the loaded cartridge keeps its RAM with a battery
+ */
+bool gb_cart_has_battery(const GBContext* ctx);
+
+/**
+ * @brief Back cartridge RAM with a .sav file
+ *
+ * The file is created or extended to the RAM size and mapped shared, so
+ * RAM writes reach it without explicit flushes and loading is instant.
+ * Longer files (e.g. with an RTC footer) are used as-is. Without mmap
+ * (Windows) the file is read now and written back by gb_context_destroy.
+ * @return false if the cartridge has no RAM or the file cannot be used
+ */
+bool gb_context_attach_save(GBContext* ctx, const char* path);
+
 /* ============================================================================
  * Memory Access
  * ========================================================================== */
@@ -399,6 +438,15 @@ static inline void gb_unpack_flags(GBContext* ctx) {
  */
 void gb_add_cycles(GBContext* ctx, uint32_t cycles);
 
+/**
+ * @brief Set the CPU overclock factor
+ * @param ctx CPU context
+ * @param percent CPU speed relative to hardware (100 = stock, 200 = twice as
+ *        many instructions per frame). PPU, APU, timers and DMA keep running
+ *        on the original timeline. Values below 100 are clamped to 100.
+ */
+void gb_set_cpu_overclock(GBContext* ctx, uint32_t percent);
+
 /**
  * @brief Check if a frame worth of cycles has elapsed
  */
@@ -407,10 +455,119 @@ bool gb_frame_complete(GBContext* ctx);
 /**
  * @brief Get the current framebuffer
  * @param ctx CPU context
- * @return Pointer to 160x144 ARGB8888 framebuffer, or NULL if not ready
+ * @return Pointer to 160x144 ARGB8888 framebuffer, or NULL if not ready or
+ *         while gb_set_video_buffer/gb_set_video_scale direct frames into a
+ *         buffer that isn't tightly packed, unscaled ARGB8888 (read that
+ *         buffer instead)
  */
 const uint32_t* gb_get_framebuffer(GBContext* ctx);
 
+/**
+ * @brief Check whether the last completed frame differs from the previous one
+ *
+ * Unchanged frames (menus, paused screens) are not re-converted; frontends
+ * can use this from on_vblank or after gb_run_frame to skip encoding/upload.
+ */
+bool gb_frame_changed(GBContext* ctx);
+
+/**
+ * @brief Convert frames straight into a caller-owned ARGB8888 buffer
+ *
+ * The next completed frame is always converted in full; gb_get_framebuffer
+ * returns this buffer while it is set, tightly packed and unscaled, and
+ * NULL otherwise.
+ * @param pixels Destination, or NULL for the internal framebuffer
+ * @param pitch  Bytes between rows (0 = tightly packed)
+ */
+void gb_set_video_buffer(GBContext* ctx, uint32_t* pixels, size_t pitch);
+
+/**
+ * @brief Upscale frames while converting them into the video buffer
+ *
+ * The buffer must then hold 144 * factor rows of 160 * factor pixels;
+ * the internal framebuffer is never scaled.
+ * @param filter A GBScaleFilter from ppu.h (GB_SCALE_NONE to turn it off)
+ */
+void gb_set_video_scale(GBContext* ctx, int filter);
+
+/**
+ * @brief Render audio into a caller-owned block instead of the internal one
+ * @param samples Interleaved frames in the current format, or NULL for the internal block
+ * @param frames  Capacity in frames; on_audio_block fires when it fills
+ */
+void gb_set_audio_buffer(GBContext* ctx, void* samples, size_t frames);
+
+/**
+ * @brief Set the audio output rate, sample format and channel count
+ * @param sample_rate Output rate in Hz (8000-192000)
+ * @param channels    1 (mono) or 2 (interleaved stereo)
+ * @return false if the configuration is not supported
+ */
+bool gb_set_audio_format(GBContext* ctx, uint32_t sample_rate, GBSampleFormat format, int channels);
+
+/**
+ * @brief Enable or disable the high-pass filter that removes the DC offset
+ *        from audio output, as the hardware's output capacitor does (default on)
+ */
+void gb_set_audio_highpass(GBContext* ctx, bool enabled);
+
+/**
+ * @brief Synthesize audio on a worker thread
+ *
+ * Sound register writes are queued with their cycle timestamps and
+ * rendered by the worker, which is woken once per frame. Audio callbacks
+ * then fire on the worker thread. Sound register reads wait for the
+ * worker to catch up.
+ *
+ * @return false if the audio thread could not be started
+ */
+bool gb_set_audio_thread(GBContext* ctx, bool enabled);
+
+/**
+ * @brief Skip drawing skip of every period frames (0 = draw every frame)
+ *
+ * Skipped frames still run full LY/STAT/interrupt timing; the framebuffer
+ * keeps the last drawn frame and gb_frame_changed() reports false.
+ */
+void gb_set_frameskip(GBContext* ctx, uint32_t skip, uint32_t period);
+
+/**
+ * @brief Don't draw the next frame (call between frames, e.g. when behind)
+ */
+void gb_skip_next_frame(GBContext* ctx);
+
+/**
+ * @brief Show the frame that lies frames ahead of emulation, hiding input lag
+ *
+ * Each gb_run_frame then runs the real frame without drawing it, snapshots
+ * the machine, emulates the given number of frames further with the same
+ * input (silent, only the last one drawn), and rolls back to the snapshot.
+ * Audio comes from the real frames only. A game that reacts to input n
+ * frames late shows the reaction right away with n frames of run-ahead.
+ * Rendering and audio synthesis run on the emulation thread while enabled.
+ * Call after the ROM is loaded.
+ *
+ * @param frames Frames to run ahead (0 = off)
+ * @return false if the snapshot buffer could not be allocated
+ */
+bool gb_set_run_ahead(GBContext* ctx, uint32_t frames);
+
+/**
+ * @brief Never rasterize; only PPU timing and interrupts run
+ */
+void gb_set_headless(GBContext* ctx, bool headless);
+
+/**
+ * @brief Render frames on a worker thread instead of inline with the CPU
+ *
+ * The emulation thread only logs each line's LCD registers and the VRAM/OAM
+ * writes in between; raster effects are preserved. Frames are presented
+ * one frame late.
+ *
+ * @return false if the render thread could not be started
+ */
+bool gb_set_deferred_rendering(GBContext* ctx, bool enabled);
+
 /**
  * @brief Reset the frame ready flag for the next frame
  * @param ctx CPU context
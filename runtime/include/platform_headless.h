@@ -0,0 +1,72 @@
+/**
+ * @file platform_headless.h
+ * @brief Headless platform backend: streams video and audio to files or pipes
+ *
+ * Needs no SDL. Frames are written as Y4M or raw RGB24 and audio as WAV or
+ * raw PCM, as fast as emulation runs, so the output can be piped straight
+ * into an encoder (e.g. ffmpeg -i video.y4m -i audio.wav ...).
+ */
+
+#ifndef GB_PLATFORM_HEADLESS_H
+#define GB_PLATFORM_HEADLESS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "gbrt.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Video stream format
+ */
+typedef enum {
+    GB_VIDEO_OUT_AUTO,   /**< Y4M for *.y4m paths and stdout, raw RGB24 otherwise */
+    GB_VIDEO_OUT_Y4M,    /**< YUV4MPEG2, 4:2:0, BT.601 limited range */
+    GB_VIDEO_OUT_RGB24   /**< Headerless 160x144 R,G,B bytes per frame */
+} GBVideoOutFormat;
+
+/**
+ * @brief Audio stream format
+ */
+typedef enum {
+    GB_AUDIO_OUT_AUTO,   /**< WAV for *.wav paths and stdout, raw PCM otherwise */
+    GB_AUDIO_OUT_WAV,    /**< RIFF WAVE (sizes patched on close when seekable) */
+    GB_AUDIO_OUT_RAW     /**< Headerless interleaved samples */
+} GBAudioOutFormat;
+
+/**
+ * @brief Output configuration; zero-initialize for defaults
+ */
+typedef struct {
+    const char* video_path;          /**< File, "-" for stdout, or NULL for no video */
+    GBVideoOutFormat video_format;
+    const char* audio_path;          /**< File, "-" for stdout, or NULL for no audio */
+    GBAudioOutFormat audio_format;
+    uint32_t sample_rate;            /**< 0 = 44100 Hz */
+    GBSampleFormat sample_format;    /**< GB_SAMPLE_S16 or GB_SAMPLE_F32 */
+    int channels;                    /**< 1 or 2 (0 = 2) */
+} GBHeadlessConfig;
+
+/**
+ * @brief Open the outputs and register audio callbacks with the context
+ * @return false if an output could not be opened
+ */
+bool gb_headless_init(GBContext* ctx, const GBHeadlessConfig* config);
+
+/**
+ * @brief Write the frame just completed (call once per gb_run_frame)
+ */
+void gb_headless_submit_frame(GBContext* ctx);
+
+/**
+ * @brief Flush and close the outputs (also runs at exit)
+ */
+void gb_headless_shutdown(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* GB_PLATFORM_HEADLESS_H */
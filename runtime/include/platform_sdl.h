@@ -19,6 +19,30 @@ extern uint8_t g_joypad_dpad;
 
 typedef struct GBContext GBContext;
 
+/**
+ * @brief What the frame loop waits on between frames
+ */
+typedef enum {
+    GB_PACING_AUDIO,  /**< Audio buffer fill level (default) */
+    GB_PACING_VSYNC   /**< Display vsync in SDL_RenderPresent */
+} GBPacingMode;
+
+/**
+ * @brief Screenshot file format for --dump-frames
+ */
+typedef enum {
+    GB_CAPTURE_PPM,   /**< Binary PPM (default) */
+    GB_CAPTURE_PNG    /**< Palette PNG, 1-4 bits per pixel for DMG frames */
+} GBCaptureFormat;
+
+/**
+ * @brief What capture does when the writer thread falls behind
+ */
+typedef enum {
+    GB_CAPTURE_BLOCK, /**< Wait for a free queue slot; every frame is kept (default) */
+    GB_CAPTURE_DROP   /**< Skip the frame and keep emulating at full speed */
+} GBCapturePolicy;
+
 /**
  * @brief Initialize SDL2 platform (window, renderer)
  * @param scale Window scale factor (1-4)
@@ -53,11 +77,48 @@ void gb_platform_render_frame(const uint32_t* framebuffer);
  */
 uint8_t gb_platform_get_joypad(void);
 
+/**
+ * @brief Whether the rewind key (R) is held
+ */
+bool gb_platform_rewind_held(void);
+
 /**
  * @brief Wait for vsync / frame timing
+ *
+ * Also applies dynamic rate control to the APU output rate.
  */
 void gb_platform_vsync(void);
 
+/**
+ * @brief Select frame pacing (call before gb_platform_init where possible)
+ */
+void gb_platform_set_pacing(GBPacingMode mode);
+
+/**
+ * @brief Upload and present frames on a dedicated thread (call before gb_platform_init)
+ *
+ * The PPU converts frames straight into a lock-free triple buffer that the
+ * presenter thread streams into the texture.
+ */
+void gb_platform_set_present_thread(bool enabled);
+
+/**
+ * @brief Skip drawing frames while emulation is behind the audio clock
+ */
+void gb_platform_set_auto_frameskip(bool enabled);
+
+/**
+ * @brief Audio ring health since startup
+ * @param underruns Frames played as silence because the ring ran dry
+ * @param overruns  Frames dropped because the ring was full
+ */
+void gb_platform_get_audio_stats(uint32_t* underruns, uint32_t* overruns);
+
+/**
+ * @brief Select screenshot format and back-pressure policy for the writer thread
+ */
+void gb_platform_set_capture(GBCaptureFormat format, GBCapturePolicy policy);
+
 /**
  * @brief Set window title
  */
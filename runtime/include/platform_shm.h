@@ -0,0 +1,121 @@
+/**
+ * @file platform_shm.h
+ * @brief Shared-memory platform backend for streaming servers (POSIX only)
+ *
+ * Completed frames and audio are published into a POSIX shared-memory
+ * object that an encoder process maps read-only. The PPU converts each
+ * frame straight into a ring slot, so frames reach the consumer without
+ * any copy. Joypad state is read from clients of a Unix domain socket.
+ *
+ * Consumer protocol:
+ *   - Map the object, check magic/version, then locate slots and the audio
+ *     ring through the offsets in GBShmHeader.
+ *   - Poll frame_seq (acquire). Frame N (1-based) lives in slot
+ *     (N - 1) % frame_slots; that slot's seq equals N once it is complete
+ *     and reads 0 while the emulator renders into it. Read the slot's seq
+ *     (acquire), copy the pixels, issue an acquire fence
+ *     (__atomic_thread_fence(__ATOMIC_ACQUIRE)), then read seq again; if
+ *     either read is not N, the frame was overwritten and must be discarded.
+ *     Without the fence, weakly ordered CPUs may load pixels after the
+ *     second seq read.
+ *   - audio_seq (acquire) counts audio frames written since start; frame i
+ *     is at ring index i % audio_capacity. Samples are overwritten in place:
+ *     after copying frames [a, b) with b <= audio_seq, issue an acquire
+ *     fence and read audio_write_seq; if audio_write_seq - a exceeds
+ *     audio_capacity, the reader fell behind and the copy may hold newer
+ *     samples, so discard it.
+ *   - Input: connect a SOCK_STREAM socket to the configured path and send
+ *     one byte per state change, active low like GBPlatformCallbacks'
+ *     get_joypad: Start/Select/B/A in bits 7-4, Down/Up/Left/Right in 3-0.
+ */
+
+#ifndef GB_PLATFORM_SHM_H
+#define GB_PLATFORM_SHM_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "gbrt.h"
+#include "ppu.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define GB_SHM_MAGIC   0x4D534247u  /* "GBSM" */
+#define GB_SHM_VERSION 2
+#define GB_SHM_FRAME_SLOTS 4
+
+/**
+ * @brief Per-slot frame metadata
+ *
+ * Fields marked (atomic) are stored with release and should be loaded with
+ * acquire ordering (e.g. __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE)).
+ */
+typedef struct {
+    uint64_t seq;        /**< (atomic) Frame number held, 0 while being written */
+    uint64_t cycles;     /**< Emulated hardware cycles at the end of the frame */
+    uint64_t audio_seq;  /**< audio_seq when the frame was published, for A/V sync */
+} GBShmSlot;
+
+/**
+ * @brief Layout at offset 0 of the shared-memory object
+ */
+typedef struct {
+    uint32_t magic;            /**< GB_SHM_MAGIC */
+    uint32_t version;          /**< GB_SHM_VERSION */
+    uint32_t header_size;      /**< sizeof(GBShmHeader) */
+    uint32_t width;            /**< 160 times the scale factor */
+    uint32_t height;           /**< 144 times the scale factor */
+    uint32_t pitch;            /**< Bytes per row of a frame (ARGB8888) */
+    uint32_t frame_slots;      /**< GB_SHM_FRAME_SLOTS */
+    uint32_t frame_offset;     /**< Byte offset of slot 0's pixels */
+    uint32_t frame_stride;     /**< Bytes between slots */
+    uint32_t sample_rate;      /**< Audio frames per second */
+    uint32_t sample_format;    /**< GBSampleFormat */
+    uint32_t channels;         /**< 1 or 2 */
+    uint32_t audio_offset;     /**< Byte offset of the audio ring */
+    uint32_t audio_capacity;   /**< Ring size in audio frames (power of two) */
+    uint32_t closed;           /**< (atomic) Set to 1 when the emulator exits */
+    uint32_t reserved;
+    uint64_t frame_seq;        /**< (atomic) Frames published so far */
+    uint64_t audio_seq;        /**< (atomic) Audio frames written so far */
+    uint64_t audio_write_seq;  /**< (atomic) End of the audio write in progress, >= audio_seq */
+    GBShmSlot slots[GB_SHM_FRAME_SLOTS];
+} GBShmHeader;
+
+/**
+ * @brief Backend configuration; zero-initialize for defaults
+ */
+typedef struct {
+    const char* name;           /**< shm_open name, e.g. "/gb-stream" */
+    const char* input_socket;   /**< Unix socket path for input, or NULL */
+    uint32_t sample_rate;       /**< 0 = 44100 Hz */
+    GBSampleFormat sample_format;
+    int channels;               /**< 1 or 2 (0 = 2) */
+    uint32_t audio_capacity;    /**< Audio ring frames, rounded up to a power of two (0 = 16384) */
+    bool unpaced;               /**< Run as fast as possible instead of in real time */
+    GBScaleFilter scale;        /**< Upscaling applied as frames are converted into the slots */
+} GBShmConfig;
+
+/**
+ * @brief Create the shared-memory object and input socket and attach them
+ * @return false if shared memory or the socket could not be set up
+ */
+bool gb_shm_init(GBContext* ctx, const GBShmConfig* config);
+
+/**
+ * @brief Publish the frame just completed and pace to real time
+ *        (call once per gb_run_frame)
+ */
+void gb_shm_submit_frame(GBContext* ctx);
+
+/**
+ * @brief Mark the stream closed, unlink the object and socket (also runs at exit)
+ */
+void gb_shm_shutdown(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* GB_PLATFORM_SHM_H */
@@ -8,6 +8,7 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -21,6 +22,24 @@ extern "C" {
 #define GB_SCREEN_HEIGHT   144
 #define GB_FRAMEBUFFER_SIZE (GB_SCREEN_WIDTH * GB_SCREEN_HEIGHT)
 
+/* Output pixel formats for ppu_convert_frame / ppu_set_output_buffer */
+typedef enum {
+    GB_PIXEL_ARGB8888,  /* 32-bit packed 0xAARRGGBB (same as rgb_framebuffer) */
+    GB_PIXEL_RGBA8888,  /* 32-bit, bytes R,G,B,A in memory */
+    GB_PIXEL_RGB565,    /* 16-bit packed 5:6:5 */
+    GB_PIXEL_INDEXED,   /* 8-bit shade index 0-3 */
+} GBPixelFormat;
+
+/* Upscaling applied while converting into an output buffer; the buffer then
+   holds GB_SCREEN_HEIGHT * factor rows of GB_SCREEN_WIDTH * factor pixels */
+typedef enum {
+    GB_SCALE_NONE,      /* 160x144 */
+    GB_SCALE_2X,        /* Nearest neighbour, 320x288 */
+    GB_SCALE_3X,        /* Nearest neighbour, 480x432 */
+    GB_SCALE_4X,        /* Nearest neighbour, 640x576 */
+    GB_SCALE_SCALE2X,   /* Scale2x edge smoothing, 320x288 */
+} GBScaleFilter;
+
 /* Scanline timing (in cycles) */
 #define CYCLES_OAM_SCAN    80   /* Mode 2: OAM search */
 #define CYCLES_PIXEL_DRAW  172  /* Mode 3: Pixel transfer (variable) */
@@ -97,6 +116,23 @@ typedef struct {
  * ========================================================================== */
 
 typedef struct GBContext GBContext;
+typedef struct PPUDeferred PPUDeferred;
+
+/**
+ * Everything a visible scanline's pixels depend on. If the key for a line
+ * matches the one stored when it was last drawn, rendering is skipped.
+ */
+typedef struct {
+    uint8_t lcdc, scx, scy, wx, wy, bgp, obp0, obp1;
+    uint8_t window_line;
+    uint8_t valid;
+    uint8_t sprite_count;
+    uint8_t reserved;
+    uint32_t tile_epoch;      /* Tile data version */
+    uint32_t bg_map_epoch;    /* Version of the BG tilemap row shown */
+    uint32_t win_map_epoch;   /* Version of the window tilemap row shown */
+    uint8_t sprites[10 * 4];  /* OAM entries on the line, in priority order */
+} PPULineKey;
 
 typedef struct GBPPU {
     /* LCD Registers (cached from I/O memory) */
@@ -120,12 +156,52 @@ typedef struct GBPPU {
     uint8_t window_line;      /* Current window internal line counter */
     bool window_triggered;    /* Window was triggered this frame */
     
+    /* Per-scanline sprite lists: OAM indices in priority order, at most
+       10 per line. Rebuilt lazily when OAM or the OBJ size changes. */
+    uint8_t line_sprites[VISIBLE_SCANLINES][10];
+    uint8_t line_sprite_count[VISIBLE_SCANLINES];
+    bool sprite_lists_dirty;
+    
+    /* Decoded tile cache (one color index per pixel, per VRAM bank).
+       Kept in sync by ppu_vram_write(); the _flip copy is mirrored
+       horizontally for X-flipped sprites. */
+    uint8_t tile_cache[2][TILES_PER_BANK][8][8];
+    uint8_t tile_cache_flip[2][TILES_PER_BANK][8][8];
+    
     /* Framebuffer (2-bit color indices) */
     uint8_t framebuffer[GB_FRAMEBUFFER_SIZE];
     
     /* RGB framebuffer for display (32-bit RGBA) */
     uint32_t rgb_framebuffer[GB_FRAMEBUFFER_SIZE];
     
+    /* Dirty tracking: VRAM version counters and per-line render keys */
+    uint32_t tile_epoch;
+    uint32_t map_row_epoch[2][32];
+    PPULineKey line_keys[VISIBLE_SCANLINES];
+    bool frame_dirty;         /* A line changed since the last converted frame */
+    bool frame_changed;       /* Last completed frame differs from the previous one */
+    
+    /* Optional caller-supplied output buffer; when set, frames are converted
+       straight into it at VBlank and rgb_framebuffer is not updated */
+    void* out_pixels;
+    GBPixelFormat out_format;
+    size_t out_pitch;
+    GBScaleFilter out_scale;
+    bool out_stale;           /* Output doesn't hold the current frame yet */
+    
+    /* Frameskip: lines are only drawn when render_frame is set for the
+       current frame. skip_count of every skip_period frames are skipped,
+       skip_next skips one frame on request, headless never draws. */
+    uint32_t skip_count;
+    uint32_t skip_period;
+    uint32_t skip_phase;
+    bool skip_next;
+    bool headless;
+    bool render_frame;
+    
+    /* Render worker state while rendering is deferred, NULL when inline */
+    PPUDeferred* deferred;
+    
     /* Frame complete flag */
     bool frame_ready;
     
@@ -171,10 +247,100 @@ bool ppu_frame_ready(GBPPU* ppu);
 void ppu_clear_frame_ready(GBPPU* ppu);
 
 /**
- * @brief Get the RGB framebuffer
+ * @brief Check whether the last completed frame differs from the one before
+ */
+bool ppu_frame_changed(GBPPU* ppu);
+
+/**
+ * @brief Get the RGB framebuffer (the output buffer when it is packed ARGB8888)
+ * @return NULL while frames are converted into an output buffer of another
+ *         format, pitch or scale, which leaves rgb_framebuffer unused
  */
 const uint32_t* ppu_get_framebuffer(GBPPU* ppu);
 
+/**
+ * @brief Convert the current frame into a buffer of the given format
+ * @param pixels Destination, GB_SCREEN_HEIGHT rows of GB_SCREEN_WIDTH pixels
+ * @param pitch  Bytes between rows (0 = tightly packed)
+ */
+void ppu_convert_frame(const GBPPU* ppu, void* pixels, GBPixelFormat format, size_t pitch);
+
+/**
+ * @brief Convert the current frame, upscaled, into a buffer of the given format
+ * @param pitch  Bytes between output rows (0 = tightly packed at the scaled width)
+ */
+void ppu_convert_frame_scaled(const GBPPU* ppu, void* pixels, GBPixelFormat format, size_t pitch,
+                              GBScaleFilter filter);
+
+/**
+ * @brief Output width/height multiplier of a scale filter
+ */
+int ppu_scale_factor(GBScaleFilter filter);
+
+/**
+ * @brief Convert every completed frame directly into a caller-owned buffer
+ * @param pixels Destination buffer, or NULL to go back to rgb_framebuffer
+ * @param pitch  Bytes between rows (0 = tightly packed)
+ */
+void ppu_set_output_buffer(GBPPU* ppu, void* pixels, GBPixelFormat format, size_t pitch);
+
+/**
+ * @brief Upscale frames converted into the output buffer (see GBScaleFilter)
+ */
+void ppu_set_output_scale(GBPPU* ppu, GBScaleFilter filter);
+
+/**
+ * @brief Update the tile cache and dirty tracking after a VRAM byte changed
+ * @param vram   Start of VRAM (both banks)
+ * @param bank   VRAM bank that was written
+ * @param offset Byte offset within the bank (0x0000-0x1FFF)
+ */
+void ppu_vram_write(GBPPU* ppu, const uint8_t* vram, uint8_t bank, uint16_t offset);
+
+/**
+ * @brief Notify the PPU that OAM contents changed (CPU write or DMA)
+ */
+void ppu_oam_write(GBPPU* ppu);
+
+/**
+ * @brief Re-decode every tile from VRAM (after bulk VRAM changes)
+ */
+void ppu_rebuild_tile_cache(GBPPU* ppu, const uint8_t* vram);
+
+/**
+ * @brief Skip drawing on some frames; LY/STAT/interrupt timing is unaffected
+ * @param skip   Frames to skip out of every period (0 = draw every frame)
+ * @param period Length of the pattern in frames; the drawn frames come first
+ */
+void ppu_set_frameskip(GBPPU* ppu, uint32_t skip, uint32_t period);
+
+/**
+ * @brief Don't draw the next frame that starts (used for automatic frameskip)
+ */
+void ppu_skip_next_frame(GBPPU* ppu);
+
+/**
+ * @brief Run only the timing state machine and never rasterize or convert
+ */
+void ppu_set_headless(GBPPU* ppu, bool headless);
+
+/**
+ * @brief Move scanline rendering to a worker thread, or back inline
+ *
+ * While deferred, the emulation thread only logs per-line register
+ * snapshots and VRAM/OAM changes; a worker renders each frame from its log
+ * while the CPU runs the next one. Completed frames are published one
+ * frame late, at the following VBlank.
+ *
+ * @return false if the worker could not be started (rendering stays inline)
+ */
+bool ppu_set_deferred(GBPPU* ppu, GBContext* ctx, bool enabled);
+
+/**
+ * @brief Convert the framebuffer to the output now instead of at the next VBlank
+ */
+void ppu_refresh_output(GBPPU* ppu);
+
 /**
  * @brief Render a scanline
  */
@@ -0,0 +1,169 @@
+/**
+ * @file savestate.h
+ * @brief Machine state snapshots and a delta-compressed rewind buffer
+ *
+ * A state is a flat buffer holding the CPU, MBC, timer, memories, cartridge
+ * RAM, PPU and APU state. Caches the PPU can rebuild (decoded tiles, sprite
+ * lists) and host settings (output buffers, sample format, frameskip,
+ * callbacks) are not part of it. Fields are stored in host byte order, so a
+ * state loads into any build of the same GB_STATE_VERSION on a host of the
+ * same endianness.
+ */
+
+#ifndef GB_SAVESTATE_H
+#define GB_SAVESTATE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "gbrt.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define GB_STATE_MAGIC   0x53534247u  /* "GBSS" */
+#define GB_STATE_VERSION 1
+
+/* ============================================================================
+ * Save States
+ * ========================================================================== */
+
+/**
+ * @brief Bytes needed for a state of this context (depends on cartridge RAM)
+ */
+size_t gb_state_size(GBContext* ctx);
+
+/**
+ * @brief Serialize the machine into buffer
+ * @return false if size is smaller than gb_state_size
+ */
+bool gb_state_save(GBContext* ctx, void* buffer, size_t size);
+
+/**
+ * @brief Restore the machine from a buffer written by gb_state_save
+ *
+ * The restored frame is converted to the output right away, so
+ * gb_get_framebuffer shows it before the next frame is run. With deferred
+ * rendering the frame in flight on the render thread is not part of a
+ * state, so the first frame after a load shows the restored one again.
+ * @return false (and the context is left untouched) if the buffer has the
+ *         wrong magic, version or size for this cartridge
+ */
+bool gb_state_load(GBContext* ctx, const void* buffer, size_t size);
+
+/**
+ * @brief Roll back to a state this context saved moments ago (run-ahead)
+ *
+ * Like gb_state_load, but the framebuffer and converted output keep the
+ * frame last shown, so frames emulated since the save stay on screen.
+ */
+bool gb_state_rollback(GBContext* ctx, const void* buffer, size_t size);
+
+/**
+ * @brief gb_state_save to a file
+ */
+bool gb_state_save_file(GBContext* ctx, const char* path);
+
+/**
+ * @brief gb_state_load from a file
+ */
+bool gb_state_load_file(GBContext* ctx, const char* path);
+
+/* ============================================================================
+ * Rewind
+ *
+ * Push a state every frame; pop walks back through them. Every
+ * keyframe_interval-th state is a keyframe, stored run-length encoded; the
+ * others are stored as the run-length encoded XOR against their keyframe,
+ * which is zero wherever memory hasn't changed since, so a frame costs a
+ * fraction of a full state.
+ * When the memory budget is exceeded the oldest states are dropped.
+ * ========================================================================== */
+
+typedef struct GBRewind GBRewind;
+
+/**
+ * @brief Create a rewind buffer for a context
+ * @param max_bytes         Memory budget for stored states
+ * @param keyframe_interval States per keyframe (0 = 60)
+ */
+GBRewind* gb_rewind_create(GBContext* ctx, size_t max_bytes, uint32_t keyframe_interval);
+
+void gb_rewind_destroy(GBRewind* rewind);
+
+/**
+ * @brief Record the current state (call once per frame)
+ */
+bool gb_rewind_push(GBRewind* rewind, GBContext* ctx);
+
+/**
+ * @brief Restore the most recently pushed state and drop it
+ * @return false when no states are left
+ */
+bool gb_rewind_pop(GBRewind* rewind, GBContext* ctx);
+
+/**
+ * @brief Number of states that can be popped
+ */
+size_t gb_rewind_count(const GBRewind* rewind);
+
+/**
+ * @brief Bytes used by stored states
+ */
+size_t gb_rewind_memory(const GBRewind* rewind);
+
+/* ============================================================================
+ * Serializer Interface (used by the runtime modules)
+ * ========================================================================== */
+
+/**
+ * @brief Cursor shared by the modules' serializers
+ *
+ * Each module lists its state fields once; the same list saves, loads or,
+ * with pos NULL, only measures.
+ */
+typedef struct GBStateCursor {
+    uint8_t* pos;     /**< Next byte, or NULL to only measure */
+    size_t size;      /**< Bytes visited so far */
+    bool load;        /**< Copy from the buffer into the fields */
+    bool rollback;    /**< Loading: leave the displayed frame alone */
+} GBStateCursor;
+
+static inline void gb_state_field(GBStateCursor* c, void* field, size_t size) {
+    if (c->pos) {
+        if (c->load) {
+            memcpy(field, c->pos, size);
+        } else {
+            memcpy(c->pos, field, size);
+        }
+        c->pos += size;
+    }
+    c->size += size;
+}
+
+#define GB_STATE_FIELD(c, field) gb_state_field((c), &(field), sizeof(field))
+
+/** @brief Step over a field without copying it */
+static inline void gb_state_skip(GBStateCursor* c, size_t size) {
+    if (c->pos) c->pos += size;
+    c->size += size;
+}
+
+struct GBPPU;
+
+/** @brief CPU, MBC, timer and memory (gbrt.c) */
+void gb_context_serialize(GBContext* ctx, GBStateCursor* c);
+
+/** @brief PPU registers, timing and framebuffer; a load rebuilds the caches */
+void ppu_serialize(struct GBPPU* ppu, GBContext* ctx, GBStateCursor* c);
+
+/** @brief APU channels, sequencer and synthesis state; a load drops undelivered samples */
+void gb_audio_serialize(GBContext* ctx, GBStateCursor* c);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* GB_SAVESTATE_H */
@@ -4,14 +4,58 @@
  */
 
 #include "audio.h"
+#include "savestate.h"
 #include "gbrt_debug.h"
 #include <stdlib.h>
 #include <string.h>
+#include <math.h>
+#include <stdio.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define AUDIO_SIMD_SSE2 1
+#include <emmintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#define AUDIO_SIMD_NEON 1
+#include <arm_neon.h>
+#endif
 
 /* ============================================================================
  * Internal Structures
  * ========================================================================== */
 
+/* Default output block size in frames (~23 ms at 44.1 kHz) */
+#define AUDIO_BLOCK_FRAMES 1024
+
+#define GB_CPU_CLOCK 4194304
+#define AUDIO_DEFAULT_RATE 44100
+
+/* Band-limited step kernel: BLEP_WIDTH taps at BLEP_PHASES sub-sample
+   offsets, each phase summing to 1 << BLEP_SHIFT */
+#define BLEP_WIDTH 16
+#define BLEP_PHASES 64
+#define BLEP_SHIFT 15
+#define BLEP_RING_SIZE 32
+#define BLEP_RING_MASK (BLEP_RING_SIZE - 1)
+
+/* Noise LFSR sequence lengths (x^15 + x^14 + 1 and x^7 + x^6 + 1) */
+#define LFSR15_PERIOD 32767
+#define LFSR7_PERIOD 127
+
+/* 4194304 / 512 = 8192 cycles per frame sequencer step */
+#define FS_PERIOD 8192
+
+/* A channel with no pending output change is looked at again after this */
+#define NO_EDGE_CYCLES (1u << 30)
+
+/* Audio thread event queue (power of two); addresses below 0xFF10 are
+   not registers and mark other events */
+#define AUDIO_QUEUE_SIZE 4096
+#define AUDIO_QUEUE_MASK (AUDIO_QUEUE_SIZE - 1)
+#define AUDIO_EVENT_FRAME_END 0x0000
+#define AUDIO_EVENT_DIV_RESET 0x0001
+
 typedef struct {
     /* Registers */
     uint8_t nr10; /* Sweep */
@@ -84,8 +128,16 @@ typedef struct {
     bool length_enabled;
     int volume;
     int env_timer;
-    uint16_t lfsr;
     bool enabled;
+    
+    /* Generation: the LFSR is tracked as a position in a precomputed
+       sequence; the register value is only rebuilt on a width change */
+    uint32_t timer;
+    uint16_t lfsr;        /* Register value when the sequence was entered */
+    uint16_t lfsr_pos;    /* Position in the 15-bit or 7-bit sequence */
+    uint32_t lfsr_steps;  /* Shifts since lfsr was captured (saturating) */
+    bool lfsr_narrow;     /* lfsr_pos indexes the 7-bit sequence */
+    bool lfsr_locked;     /* All-zero state: bit 0 never changes */
 } Channel4;
 
 typedef struct GBAudio {
@@ -98,13 +150,52 @@ typedef struct GBAudio {
     uint8_t nr51; /* Selection of Sound output terminal */
     uint8_t nr52; /* Sound on/off */
     
+    /* Mixer: per-channel weights for left (0-3) and right (4-7), from NR50/NR51 */
+    int16_t pan_weights[8];
+    
     /* Frame Sequencer */
-    uint32_t fs_timer;
     int fs_step;
     
+    /* Event scheduling, in APU cycles (wrapping) */
+    uint32_t now;             /* Time rendered up to */
+    uint32_t fs_at;           /* Next 512 Hz frame sequencer step */
+    uint32_t settled_at[4];   /* When each channel's timer was last brought up to date */
+    uint32_t edge_at[4];      /* Each channel's next audible output transition */
+    
     /* Sample Generation */
-    uint32_t sample_timer;
-    uint32_t sample_period; /* Cycles per sample */
+    uint32_t last_cycles;   /* ctx->cycles the APU has been rendered up to */
+    uint32_t sample_rate;
+    uint32_t clock_acc;     /* Progress to the next output sample, in cycles * sample_rate */
+    GBSampleFormat format;
+    int channels;
+    
+    /* Band-limited synthesis: each change of the mixed output adds a scaled
+       band-limited impulse to blep_ring; output samples are its running sum */
+    int amp[2];             /* Current mixed amplitude (left, right) */
+    int32_t blep_ring[2][BLEP_RING_SIZE];
+    int32_t blep_sum[2];
+    uint32_t blep_pos;
+    
+    /* Output stage: integrated frames are staged, then filtered and
+       converted to the output format a block at a time */
+    int32_t stage[AUDIO_BLOCK_FRAMES * 2];
+    float work[AUDIO_BLOCK_FRAMES * 2];
+    size_t stage_count;
+    bool highpass;
+    float hp_charge;        /* Output capacitor charge factor per sample */
+    float hp_cap[2];
+    
+    /* Output block, caller-owned or internal */
+    void* out;
+    size_t out_frames;
+    size_t out_count;
+    float internal_block[AUDIO_BLOCK_FRAMES * 2];
+    
+    /* Worker thread, or NULL when rendering on the emulation thread */
+    struct AudioThread* thread;
+    
+    /* No synthesis or output, only state the CPU can observe (run-ahead) */
+    bool silent;
     
 } GBAudio;
 
@@ -119,9 +210,177 @@ static const uint8_t DUTY_CYCLES[4][8] = {
     {0, 1, 1, 1, 1, 1, 1, 0}  /* 75% */
 };
 
+/* Timer periods from each duty position until the output next changes */
+static const uint8_t DUTY_RUNS[4][8] = {
+    {7, 6, 5, 4, 3, 2, 1, 1},
+    {1, 6, 5, 4, 3, 2, 1, 2},
+    {1, 4, 3, 2, 1, 4, 3, 2},
+    {1, 6, 5, 4, 3, 2, 1, 2}
+};
+
 /* Noise Divisors: (Divider code) => (Divisor) */
 static const int NOISE_DIVISORS[8] = { 8, 16, 32, 48, 64, 80, 96, 112 };
 
+static inline uint32_t square_period(uint8_t lo, uint8_t hi) {
+    return (2048 - (lo | ((hi & 0x07) << 8))) * 4;
+}
+
+static inline uint32_t wave_period(uint8_t lo, uint8_t hi) {
+    /* Wave channel is 2x faster clocking? 65536Hz base */
+    /* TODO: Verify wave timing scalar */
+    return (2048 - (lo | ((hi & 0x07) << 8))) * 2;
+}
+
+/**
+ * @brief 4-bit wave sample at a position, after the NR32 volume shift
+ */
+static inline int wave_level(const Channel3* ch, int pos) {
+    static const uint8_t shifts[4] = { 4, 0, 1, 2 }; /* Mute, 100%, 50%, 25% */
+    uint8_t byte = ch->wave_ram[pos / 2];
+    uint8_t sample = (pos & 1) ? (byte & 0x0F) : (byte >> 4);
+    return sample >> shifts[(ch->nr32 >> 5) & 3];
+}
+
+static inline uint32_t noise_period(uint8_t nr43) {
+    uint32_t period = NOISE_DIVISORS[nr43 & 0x07] << (nr43 >> 4);
+    /* Minimum period is 8 cycles? */
+    return (period < 8) ? 8 : period;
+}
+
+/**
+ * @brief Precomputed noise sequences
+ *
+ * Bit 0 of the LFSR at every position of the 15-bit sequence (seeded with
+ * 0x7FFF) and the 7-bit sequence (low bits seeded with 0x7F), plus the
+ * number of shifts until bit 0 next changes. The channel advances by any
+ * number of shifts with one modulo and reads its output by indexing.
+ */
+static uint8_t lfsr15_bits[(LFSR15_PERIOD + 7) / 8];
+static uint8_t lfsr15_run[LFSR15_PERIOD];
+static uint8_t lfsr7_bits[(LFSR7_PERIOD + 7) / 8];
+static uint8_t lfsr7_run[LFSR7_PERIOD];
+static uint8_t lfsr7_index[128];  /* Low 7 bits -> 7-bit sequence position */
+static bool lfsr_tables_ready = false;
+
+static inline uint16_t lfsr_shift(uint16_t lfsr, bool narrow) {
+    uint16_t xor_res = (lfsr & 1) ^ ((lfsr >> 1) & 1);
+    lfsr >>= 1;
+    lfsr |= (xor_res << 14);
+    if (narrow) { /* 7-bit mode */
+        lfsr &= ~0x40;
+        lfsr |= (xor_res << 6);
+    }
+    return lfsr;
+}
+
+static inline int lfsr_seq_bit(const uint8_t* bits, uint32_t pos) {
+    return (bits[pos >> 3] >> (pos & 7)) & 1;
+}
+
+static void build_lfsr_sequence(uint8_t* bits, uint8_t* run, uint32_t period,
+                                uint16_t seed, bool narrow) {
+    uint16_t lfsr = seed;
+    for (uint32_t pos = 0; pos < period; pos++) {
+        if (lfsr & 1) bits[pos >> 3] |= (uint8_t)(1 << (pos & 7));
+        if (narrow) lfsr7_index[lfsr & 0x7F] = (uint8_t)pos;
+        lfsr = lfsr_shift(lfsr, narrow);
+    }
+    for (uint32_t pos = 0; pos < period; pos++) {
+        int bit = lfsr_seq_bit(bits, pos);
+        uint32_t n = 1;
+        while (lfsr_seq_bit(bits, (pos + n) % period) == bit) n++;
+        run[pos] = (uint8_t)n;
+    }
+}
+
+static void init_lfsr_tables(void) {
+    if (lfsr_tables_ready) return;
+    build_lfsr_sequence(lfsr15_bits, lfsr15_run, LFSR15_PERIOD, 0x7FFF, false);
+    build_lfsr_sequence(lfsr7_bits, lfsr7_run, LFSR7_PERIOD, 0x7F, true);
+    lfsr_tables_ready = true;
+}
+
+/**
+ * @brief Current LFSR bit 0
+ */
+static inline int lfsr_output(const Channel4* ch) {
+    if (ch->lfsr_locked) return 0;
+    return ch->lfsr_narrow ? lfsr_seq_bit(lfsr7_bits, ch->lfsr_pos)
+                           : lfsr_seq_bit(lfsr15_bits, ch->lfsr_pos);
+}
+
+/**
+ * @brief Shifts until LFSR bit 0 changes (UINT32_MAX if it never does)
+ */
+static inline uint32_t lfsr_run(const Channel4* ch) {
+    if (ch->lfsr_locked) return UINT32_MAX;
+    return ch->lfsr_narrow ? lfsr7_run[ch->lfsr_pos] : lfsr15_run[ch->lfsr_pos];
+}
+
+static inline void lfsr_advance(Channel4* ch, uint32_t shifts) {
+    uint32_t period = ch->lfsr_narrow ? LFSR7_PERIOD : LFSR15_PERIOD;
+    ch->lfsr_pos = (uint16_t)((ch->lfsr_pos + shifts) % period);
+    ch->lfsr_steps = (ch->lfsr_steps + shifts < ch->lfsr_steps) ? UINT32_MAX : ch->lfsr_steps + shifts;
+}
+
+/**
+ * @brief Rebuild the full 15-bit register from the sequence position
+ */
+static uint16_t lfsr_value(const Channel4* ch) {
+    if (ch->lfsr_locked || ch->lfsr_steps < 8) {
+        /* Short history: upper bits still come from the captured value */
+        uint16_t lfsr = ch->lfsr;
+        uint32_t steps = (ch->lfsr_steps < 8) ? ch->lfsr_steps : 8;
+        for (uint32_t i = 0; i < steps; i++) lfsr = lfsr_shift(lfsr, ch->lfsr_narrow);
+        return lfsr;
+    }
+    
+    /* Bit k of the register is the output k shifts ahead */
+    uint16_t value = 0;
+    if (!ch->lfsr_narrow) {
+        for (int k = 0; k < 15; k++) {
+            value |= lfsr_seq_bit(lfsr15_bits, (ch->lfsr_pos + k) % LFSR15_PERIOD) << k;
+        }
+        return value;
+    }
+    
+    /* 7-bit mode feeds bits 14 and 6 alike, so after 8 shifts bits 8-14
+       mirror bits 0-6 and bit 7 holds the previous output */
+    for (int k = 0; k < 7; k++) {
+        value |= lfsr_seq_bit(lfsr7_bits, (ch->lfsr_pos + k) % LFSR7_PERIOD) << k;
+    }
+    int prev = lfsr_seq_bit(lfsr7_bits, (ch->lfsr_pos + LFSR7_PERIOD - 1) % LFSR7_PERIOD);
+    return (uint16_t)(value | (prev << 7) | (value << 8));
+}
+
+/**
+ * @brief Enter the 15-bit or 7-bit sequence at the given register value
+ */
+static void lfsr_seek(Channel4* ch, uint16_t lfsr, bool narrow) {
+    ch->lfsr = lfsr;
+    ch->lfsr_steps = 0;
+    ch->lfsr_narrow = narrow;
+    ch->lfsr_pos = 0;
+    ch->lfsr_locked = false;
+    
+    if (narrow) {
+        ch->lfsr_locked = (lfsr & 0x7F) == 0;
+        ch->lfsr_pos = lfsr7_index[lfsr & 0x7F];
+        return;
+    }
+    
+    /* Width changes are rare, so a walk beats a 64 KB reverse table */
+    uint16_t value = 0x7FFF;
+    for (uint32_t pos = 0; pos < LFSR15_PERIOD; pos++) {
+        if (value == lfsr) {
+            ch->lfsr_pos = (uint16_t)pos;
+            return;
+        }
+        value = lfsr_shift(value, false);
+    }
+    ch->lfsr_locked = true;  /* Zero is not on the sequence */
+}
+
 static uint16_t calc_sweep(Channel1* ch) {
     uint16_t new_freq = ch->shadow_freq;
     uint8_t shift = ch->nr10 & 0x07;
@@ -135,6 +394,16 @@ static uint16_t calc_sweep(Channel1* ch) {
     return new_freq;
 }
 
+static void update_output(GBAudio* apu);
+static void render_to(GBContext* ctx, GBAudio* apu, uint32_t cycles);
+static void flush_block(GBContext* ctx, GBAudio* apu);
+static void thread_push(GBAudio* apu, uint32_t cycles, uint16_t addr, uint8_t value);
+static void thread_drain(GBAudio* apu);
+static void thread_stop(GBAudio* apu);
+static void settle_channel(GBAudio* apu, int n);
+static void settle_channels(GBAudio* apu);
+static void schedule_channels(GBAudio* apu);
+
 static void step_envelope(int* timer, int* volume, uint8_t env_reg) {
     if (*timer > 0) {
         (*timer)--;
@@ -152,6 +421,64 @@ static void step_envelope(int* timer, int* volume, uint8_t env_reg) {
     }
 }
 
+/**
+ * @brief Recompute the mixer weights after an NR50/NR51 change
+ */
+static void update_pan_weights(GBAudio* apu) {
+    /* Channels are 0-15 each, mixed. Max possible value: 15 * 4 * 8 = 480.
+       32767 / 480 = 68. Using 64 provides good volume without clipping. */
+    int16_t left = (int16_t)((((apu->nr50 >> 4) & 7) + 1) * 64);
+    int16_t right = (int16_t)(((apu->nr50 & 7) + 1) * 64);
+    
+    for (int n = 0; n < 4; n++) {
+        apu->pan_weights[n] = (apu->nr51 & (0x10 << n)) ? left : 0;
+        apu->pan_weights[4 + n] = (apu->nr51 & (0x01 << n)) ? right : 0;
+    }
+}
+
+static float highpass_charge(uint32_t sample_rate) {
+    /* 0.999958 per CPU cycle, compounded over one output sample */
+    return (float)pow(0.999958, (double)GB_CPU_CLOCK / sample_rate);
+}
+
+/**
+ * @brief Band-limited impulse per sub-sample phase
+ *
+ * Blackman-windowed sinc with its cutoff just under Nyquist, centred at
+ * BLEP_WIDTH / 2 + phase / BLEP_PHASES. Each phase is quantised to sum to
+ * exactly 1 << BLEP_SHIFT so the running sum never drifts.
+ */
+static int16_t blep_kernel[BLEP_PHASES][BLEP_WIDTH];
+static bool blep_kernel_ready = false;
+
+static void init_blep_kernel(void) {
+    if (blep_kernel_ready) return;
+    
+    const double pi = 3.14159265358979323846;
+    const double cutoff = 0.9;
+    for (int p = 0; p < BLEP_PHASES; p++) {
+        double taps[BLEP_WIDTH];
+        double sum = 0.0;
+        for (int i = 0; i < BLEP_WIDTH; i++) {
+            double x = i - (BLEP_WIDTH / 2) - (double)p / BLEP_PHASES;
+            double sinc = (x == 0.0) ? 1.0 : sin(pi * cutoff * x) / (pi * cutoff * x);
+            double w = (i + 1.0 - (double)p / BLEP_PHASES) / BLEP_WIDTH;
+            double window = 0.42 - 0.5 * cos(2.0 * pi * w) + 0.08 * cos(4.0 * pi * w);
+            taps[i] = sinc * window;
+            sum += taps[i];
+        }
+        
+        int total = 0;
+        for (int i = 0; i < BLEP_WIDTH; i++) {
+            blep_kernel[p][i] = (int16_t)lrint(taps[i] / sum * (1 << BLEP_SHIFT));
+            total += blep_kernel[p][i];
+        }
+        /* Put the rounding error on the centre tap */
+        blep_kernel[p][BLEP_WIDTH / 2] += (int16_t)((1 << BLEP_SHIFT) - total);
+    }
+    blep_kernel_ready = true;
+}
+
 /* ============================================================================
  * Public Interface
  * ========================================================================== */
@@ -160,21 +487,50 @@ void* gb_audio_create(void) {
     GBAudio* apu = (GBAudio*)calloc(1, sizeof(GBAudio));
     if (!apu) return NULL;
     
-    /* Approx 70224 cycles per frame / 59.7 fps = ~4.19 MHz */
-    /* 4194304 / 44100 = ~95 cycles per sample */
-    apu->sample_period = 95;
+    init_blep_kernel();
+    init_lfsr_tables();
+    apu->sample_rate = AUDIO_DEFAULT_RATE;
+    apu->format = GB_SAMPLE_S16;
+    apu->channels = 2;
+    apu->out = apu->internal_block;
+    apu->out_frames = AUDIO_BLOCK_FRAMES;
+    apu->fs_at = FS_PERIOD;
+    apu->highpass = true;
+    apu->hp_charge = highpass_charge(apu->sample_rate);
     
     return apu;
 }
 
 void gb_audio_destroy(void* apu) {
+    if (apu) thread_stop((GBAudio*)apu);
     free(apu);
 }
 
 void gb_audio_reset(void* apu_ptr) {
     GBAudio* apu = (GBAudio*)apu_ptr;
+    
+    /* The output configuration and timeline position survive a reset */
+    void* out = (apu->out == (void*)apu->internal_block) ? NULL : apu->out;
+    size_t out_frames = apu->out_frames;
+    uint32_t last_cycles = apu->last_cycles;
+    uint32_t sample_rate = apu->sample_rate;
+    GBSampleFormat format = apu->format;
+    int channels = apu->channels;
+    bool highpass = apu->highpass;
+    struct AudioThread* thread = apu->thread;
+    
+    thread_drain(apu);
     memset(apu, 0, sizeof(GBAudio));
-    apu->sample_period = 95;
+    apu->thread = thread;
+    apu->out = out ? out : apu->internal_block;
+    apu->out_frames = out_frames;
+    apu->last_cycles = last_cycles;
+    apu->sample_rate = sample_rate;
+    apu->format = format;
+    apu->channels = channels;
+    apu->fs_at = FS_PERIOD;
+    apu->highpass = highpass;
+    apu->hp_charge = highpass_charge(sample_rate);
     
     /* Initial Register Values (Standard DMG) */
     apu->ch1.nr10 = 0x80;
@@ -199,11 +555,13 @@ void gb_audio_reset(void* apu_ptr) {
     apu->nr50 = 0x77;
     apu->nr51 = 0xF3;
     apu->nr52 = 0xF1; /* Audio ON */
+    update_pan_weights(apu);
 }
 
 uint8_t gb_audio_read(GBContext* ctx, uint16_t addr) {
     GBAudio* apu = (GBAudio*)ctx->apu;
     if (!apu) return 0xFF;
+    gb_audio_sync(ctx);
     
     /* If audio is disabled via NR52 bit 7, most registers are 0xFF? 
        Actually, on DMG they are mostly readable. Stick to mask behavior for now. */
@@ -256,6 +614,7 @@ uint8_t gb_audio_read(GBContext* ctx, uint16_t addr) {
         case 0xFF30 ... 0xFF3F:
             if (apu->ch3.enabled) {
                 /* On DMG, if channel 3 is enabled, reading Wave RAM returns the byte currently being accessed */
+                settle_channel(apu, 2);
                 return apu->ch3.wave_ram[apu->ch3.wave_pos / 2];
             }
             return apu->ch3.wave_ram[addr - 0xFF30];
@@ -264,11 +623,7 @@ uint8_t gb_audio_read(GBContext* ctx, uint16_t addr) {
     }
 }
 
-
-void gb_audio_write(GBContext* ctx, uint16_t addr, uint8_t value) {
-    GBAudio* apu = (GBAudio*)ctx->apu;
-    if (!apu) return;
-    
+static void write_register(GBAudio* apu, uint16_t addr, uint8_t value) {
     /* If APU disabled (NR52 bit 7 off), write to registers ignored unless it's NR52 or Wave RAM */
     bool power_on = (apu->nr52 & 0x80) != 0;
     
@@ -377,7 +732,13 @@ void gb_audio_write(GBContext* ctx, uint16_t addr, uint8_t value) {
             apu->ch4.nr42 = value; 
             if ((value & 0xF8) == 0) apu->ch4.enabled = false;
             break;
-        case 0xFF22: apu->ch4.nr43 = value; break;
+        case 0xFF22:
+            if (((value & 0x08) != 0) != apu->ch4.lfsr_narrow) {
+                /* Width change: continue from the same register value */
+                lfsr_seek(&apu->ch4, lfsr_value(&apu->ch4), (value & 0x08) != 0);
+            }
+            apu->ch4.nr43 = value;
+            break;
         case 0xFF23: 
             apu->ch4.nr44 = value;
             if (value & 0x80) {
@@ -391,7 +752,7 @@ void gb_audio_write(GBContext* ctx, uint16_t addr, uint8_t value) {
                 if (apu->ch4.env_timer == 0) apu->ch4.env_timer = 8;
                 
                 /* LFSR Reload */
-                apu->ch4.lfsr = 0x7FFF;
+                lfsr_seek(&apu->ch4, 0x7FFF, (apu->ch4.nr43 & 0x08) != 0);
             }
             break;
             
@@ -411,221 +772,721 @@ void gb_audio_write(GBContext* ctx, uint16_t addr, uint8_t value) {
     }
 }
 
-void gb_audio_step(GBContext* ctx, uint32_t cycles) {
+/**
+ * @brief Apply a register write at the current APU time
+ */
+static void apply_write(GBAudio* apu, uint16_t addr, uint8_t value) {
+    settle_channels(apu);  /* Timers ran at the old settings up to now */
+    write_register(apu, addr, value);
+    update_pan_weights(apu);
+    schedule_channels(apu);
+    update_output(apu);  /* Volume, routing or trigger may change the level */
+}
+
+void gb_audio_write(GBContext* ctx, uint16_t addr, uint8_t value) {
     GBAudio* apu = (GBAudio*)ctx->apu;
-    if (!apu || !(apu->nr52 & 0x80)) return;
-    
-    /* Advance Frame Sequencer (512 Hz) */
-    /* 4194304 / 512 = 8192 cycles */
-    apu->fs_timer += cycles;
-    while (apu->fs_timer >= 8192) {
-        apu->fs_timer -= 8192;
-        apu->fs_step = (apu->fs_step + 1) & 7;
-        
-        /* Step Length (256 Hz): Steps 0, 2, 4, 6 */
-        if ((apu->fs_step & 1) == 0) {
-            /* Channel 1 Length */
-            if (apu->ch1.length_enabled && apu->ch1.length_counter > 0) {
-                apu->ch1.length_counter--;
-                if (apu->ch1.length_counter == 0) apu->ch1.enabled = false;
+    if (!apu) return;
+    
+    if (apu->thread) {
+        thread_push(apu, ctx->cycles, addr, value);
+        return;
+    }
+    gb_audio_sync(ctx);
+    apply_write(apu, addr, value);
+}
+
+/* ============================================================================
+ * Sample Generation
+ *
+ * The APU is rendered lazily. Nothing runs per instruction; instead
+ * gb_audio_sync() catches up to the CPU's cycle count whenever a sound
+ * register is accessed, DIV is reset or a frame ends. Within a render,
+ * each channel knows when its output next changes and the frame sequencer
+ * is scheduled at its 512 Hz steps; nothing is evaluated in between.
+ * Samples go into an output block that is handed to the frontend when it
+ * fills and at the end of every frame.
+ * ========================================================================== */
+
+/**
+ * @brief Clock the 512 Hz frame sequencer once (length, sweep, envelope)
+ */
+static void clock_frame_sequencer(GBAudio* apu) {
+    apu->fs_step = (apu->fs_step + 1) & 7;
+    
+    /* Step Length (256 Hz): Steps 0, 2, 4, 6 */
+    if ((apu->fs_step & 1) == 0) {
+        /* Channel 1 Length */
+        if (apu->ch1.length_enabled && apu->ch1.length_counter > 0) {
+            apu->ch1.length_counter--;
+            if (apu->ch1.length_counter == 0) apu->ch1.enabled = false;
+        }
+        /* Channel 2 Length */
+        if (apu->ch2.length_enabled && apu->ch2.length_counter > 0) {
+            apu->ch2.length_counter--;
+            if (apu->ch2.length_counter == 0) apu->ch2.enabled = false;
+        }
+    }
+    
+    /* Step Sweep (128 Hz): Steps 2, 6 */
+    if (apu->fs_step == 2 || apu->fs_step == 6) {
+        Channel1* ch1 = &apu->ch1;
+        if (ch1->sweep_enabled && ch1->enabled) {
+            ch1->sweep_timer--;
+            if (ch1->sweep_timer <= 0) {
+                /* Reload timer */
+                uint8_t period = (ch1->nr10 >> 4) & 0x07;
+                ch1->sweep_timer = (period == 0) ? 8 : period;
+                
+                if (period > 0 && (ch1->nr10 & 0x07) > 0) {
+                    uint16_t new_freq = calc_sweep(ch1);
+                    if (new_freq <= 2047) {
+                        ch1->shadow_freq = new_freq;
+                        ch1->nr13 = new_freq & 0xFF;
+                        ch1->nr14 = (ch1->nr14 & ~0x07) | ((new_freq >> 8) & 0x07);
+                        /* Perform semantic overflow check again */
+                        if (calc_sweep(ch1) > 2047) ch1->enabled = false;
+                    } else {
+                        ch1->enabled = false;
+                    }
+                }
+            }
+        }
+    }
+    
+    /* Step Envelope (64 Hz): Step 7 */
+    if (apu->fs_step == 7) {
+        if (apu->ch1.enabled) step_envelope(&apu->ch1.env_timer, &apu->ch1.volume, apu->ch1.nr12);
+        if (apu->ch2.enabled) step_envelope(&apu->ch2.env_timer, &apu->ch2.volume, apu->ch2.nr22);
+        if (apu->ch4.enabled) step_envelope(&apu->ch4.env_timer, &apu->ch4.volume, apu->ch4.nr42);
+    }
+}
+
+/**
+ * @brief Advance a waveform position by however many periods fit in the timer
+ */
+static inline void step_wave_timer(uint32_t* timer, int* pos, int mask, uint32_t period, uint32_t cycles) {
+    *timer += cycles;
+    if (*timer >= period) {
+        *pos = (*pos + (int)(*timer / period)) & mask;
+        *timer %= period;
+    }
+}
+
+/**
+ * @brief Bring one channel's frequency timer up to the current APU time
+ *
+ * Channels are not stepped while rendering; their position is derived
+ * from the time elapsed since they were last settled.
+ */
+static void settle_channel(GBAudio* apu, int n) {
+    uint32_t elapsed = apu->now - apu->settled_at[n];
+    apu->settled_at[n] = apu->now;
+    
+    switch (n) {
+        case 0:
+            if (apu->ch1.enabled) {
+                step_wave_timer(&apu->ch1.timer, &apu->ch1.wave_pos, 7,
+                                square_period(apu->ch1.nr13, apu->ch1.nr14), elapsed);
+            }
+            break;
+        case 1:
+            if (apu->ch2.enabled) {
+                step_wave_timer(&apu->ch2.timer, &apu->ch2.wave_pos, 7,
+                                square_period(apu->ch2.nr23, apu->ch2.nr24), elapsed);
+            }
+            break;
+        case 2:
+            if (apu->ch3.enabled) {
+                step_wave_timer(&apu->ch3.timer, &apu->ch3.wave_pos, 31,
+                                wave_period(apu->ch3.nr33, apu->ch3.nr34), elapsed);
+            }
+            break;
+        case 3:
+            if (apu->ch4.enabled) {
+                /* Polynomial Counter */
+                uint32_t period = noise_period(apu->ch4.nr43);
+                apu->ch4.timer += elapsed;
+                if (apu->ch4.timer >= period) {
+                    lfsr_advance(&apu->ch4, apu->ch4.timer / period);
+                    apu->ch4.timer %= period;
+                }
+            }
+            break;
+    }
+}
+
+/**
+ * @brief Compute when a settled channel's output next changes
+ *
+ * Silent channels (disabled, DAC off, zero volume, unrouted, or a flat
+ * wave) get no edge; register writes and frame sequencer steps reschedule
+ * every channel, so they are picked up again when that changes.
+ */
+static void schedule_channel(GBAudio* apu, int n) {
+    uint32_t periods = 0;  /* Timer periods until the output changes, 0 = never */
+    uint32_t period = 1;
+    uint32_t timer = 0;
+    
+    switch (n) {
+        case 0: {
+            const Channel1* ch = &apu->ch1;
+            if (ch->enabled && (ch->nr12 & 0xF0) && ch->volume > 0 && (apu->nr51 & 0x11)) {
+                periods = DUTY_RUNS[(ch->nr11 >> 6) & 3][ch->wave_pos];
+                period = square_period(ch->nr13, ch->nr14);
+                timer = ch->timer;
             }
-            /* Channel 2 Length */
-            if (apu->ch2.length_enabled && apu->ch2.length_counter > 0) {
-                apu->ch2.length_counter--;
-                if (apu->ch2.length_counter == 0) apu->ch2.enabled = false;
+            break;
+        }
+        case 1: {
+            const Channel2* ch = &apu->ch2;
+            if (ch->enabled && (ch->nr22 & 0xF0) && ch->volume > 0 && (apu->nr51 & 0x22)) {
+                periods = DUTY_RUNS[(ch->nr21 >> 6) & 3][ch->wave_pos];
+                period = square_period(ch->nr23, ch->nr24);
+                timer = ch->timer;
             }
+            break;
         }
-        
-        /* Step Sweep (128 Hz): Steps 2, 6 */
-        if (apu->fs_step == 2 || apu->fs_step == 6) {
-            Channel1* ch1 = &apu->ch1;
-            if (ch1->sweep_enabled && ch1->enabled) {
-                ch1->sweep_timer--;
-                if (ch1->sweep_timer <= 0) {
-                    /* Reload timer */
-                    uint8_t period = (ch1->nr10 >> 4) & 0x07;
-                    ch1->sweep_timer = (period == 0) ? 8 : period;
-                    
-                    if (period > 0 && (ch1->nr10 & 0x07) > 0) {
-                        uint16_t new_freq = calc_sweep(ch1);
-                        if (new_freq <= 2047) {
-                            ch1->shadow_freq = new_freq;
-                            ch1->nr13 = new_freq & 0xFF;
-                            ch1->nr14 = (ch1->nr14 & ~0x07) | ((new_freq >> 8) & 0x07);
-                            /* Perform semantic overflow check again */
-                            if (calc_sweep(ch1) > 2047) ch1->enabled = false;
-                        } else {
-                            ch1->enabled = false;
-                        }
+        case 2: {
+            const Channel3* ch = &apu->ch3;
+            if (ch->enabled && (ch->nr30 & 0x80) && (ch->nr32 & 0x60) && (apu->nr51 & 0x44)) {
+                int level = wave_level(ch, ch->wave_pos);
+                for (int k = 1; k <= 32; k++) {
+                    if (wave_level(ch, (ch->wave_pos + k) & 31) != level) {
+                        periods = (uint32_t)k;
+                        break;
                     }
                 }
+                period = wave_period(ch->nr33, ch->nr34);
+                timer = ch->timer;
             }
+            break;
         }
-        
-        /* Step Envelope (64 Hz): Step 7 */
-        if (apu->fs_step == 7) {
-            if (apu->ch1.enabled) step_envelope(&apu->ch1.env_timer, &apu->ch1.volume, apu->ch1.nr12);
-            if (apu->ch2.enabled) step_envelope(&apu->ch2.env_timer, &apu->ch2.volume, apu->ch2.nr22);
-            if (apu->ch4.enabled) step_envelope(&apu->ch4.env_timer, &apu->ch4.volume, apu->ch4.nr42);
+        case 3: {
+            const Channel4* ch = &apu->ch4;
+            if (ch->enabled && (ch->nr42 & 0xF0) && ch->volume > 0 && (apu->nr51 & 0x88)) {
+                /* Only shifts that change bit 0 are audible */
+                uint32_t run = lfsr_run(ch);
+                if (run != UINT32_MAX) periods = run;
+                period = noise_period(ch->nr43);
+                timer = ch->timer;
+            }
+            break;
         }
     }
     
-    /* Generate Samples? */
-    /* 4194304 Hz / 44100 Hz = 95.1 cycles/sample */
-    apu->sample_timer += cycles;
+    if (periods == 0) {
+        apu->edge_at[n] = apu->now + NO_EDGE_CYCLES;
+        return;
+    }
+    /* A shortened period can leave the timer already past due */
+    uint32_t due = periods * period;
+    apu->edge_at[n] = apu->now + ((timer < due) ? due - timer : 0);
+}
+
+static void settle_channels(GBAudio* apu) {
+    for (int n = 0; n < 4; n++) settle_channel(apu, n);
+}
+
+static void schedule_channels(GBAudio* apu) {
+    for (int n = 0; n < 4; n++) schedule_channel(apu, n);
+}
+
+/**
+ * @brief Cycles until the next scheduled event (channel edge or frame sequencer)
+ */
+static uint32_t next_event(const GBAudio* apu) {
+    uint32_t next = apu->fs_at - apu->now;
+    for (int n = 0; n < 4; n++) {
+        uint32_t until = apu->edge_at[n] - apu->now;
+        if (until < next) next = until;
+    }
+    return next;
+}
+
+/**
+ * @brief Mix the current channel outputs into one stereo level
+ *
+ * Channel levels are weighted by the NR51 routing and NR50 master volume
+ * in one multiply-add (pan_weights).
+ */
+static void mix_channels(GBAudio* apu, int* out_left, int* out_right) {
+    int16_t level[8] = {0};
+    
+    /* Channel 1 Output */
+    if (apu->ch1.enabled && (apu->ch1.nr12 & 0xF0)) { // DAC ON
+         int duty = (apu->ch1.nr11 >> 6) & 3;
+         if (DUTY_CYCLES[duty][apu->ch1.wave_pos]) level[0] = (int16_t)apu->ch1.volume;
+    }
     
-    /* Channel 1 Stepping */
-    if (apu->ch1.enabled) {
-        uint16_t freq_raw = apu->ch1.nr13 | ((apu->ch1.nr14 & 0x07) << 8);
-        uint32_t period = (2048 - freq_raw) * 4;
-        if (period == 0) period = 4;
-        
-        apu->ch1.timer += cycles;
-        while (apu->ch1.timer >= period) {
-            apu->ch1.timer -= period;
-            apu->ch1.wave_pos = (apu->ch1.wave_pos + 1) & 7;
+    /* Channel 2 Output */
+    if (apu->ch2.enabled && (apu->ch2.nr22 & 0xF0)) { // DAC ON
+         int duty = (apu->ch2.nr21 >> 6) & 3;
+         if (DUTY_CYCLES[duty][apu->ch2.wave_pos]) level[1] = (int16_t)apu->ch2.volume;
+    }
+
+    /* Channel 3 Output */
+    if (apu->ch3.enabled && (apu->ch3.nr30 & 0x80)) { // DAC ON
+         /* Get wave sample (4-bit), volume shift applied */
+         level[2] = (int16_t)wave_level(&apu->ch3, apu->ch3.wave_pos);
+    }
+
+    /* Channel 4 Output */
+    if (apu->ch4.enabled && (apu->ch4.nr42 & 0xF0)) { // DAC ON
+         /* Output is inverted bit 0 */
+         if (!lfsr_output(&apu->ch4)) level[3] = (int16_t)apu->ch4.volume;
+    }
+    
+    for (int n = 0; n < 4; n++) level[4 + n] = level[n];
+    
+#if defined(AUDIO_SIMD_SSE2)
+    __m128i prod = _mm_madd_epi16(_mm_loadu_si128((const __m128i*)level),
+                                  _mm_loadu_si128((const __m128i*)apu->pan_weights));
+    /* prod = {L0+L1, L2+L3, R0+R1, R2+R3} */
+    __m128i sums = _mm_add_epi32(prod, _mm_shuffle_epi32(prod, _MM_SHUFFLE(2, 3, 0, 1)));
+    *out_left = _mm_cvtsi128_si32(sums);
+    *out_right = _mm_cvtsi128_si32(_mm_shuffle_epi32(sums, _MM_SHUFFLE(2, 2, 2, 2)));
+#elif defined(AUDIO_SIMD_NEON)
+    int16x8_t lv = vld1q_s16(level);
+    int16x8_t wv = vld1q_s16(apu->pan_weights);
+    *out_left = vaddvq_s32(vmull_s16(vget_low_s16(lv), vget_low_s16(wv)));
+    *out_right = vaddvq_s32(vmull_s16(vget_high_s16(lv), vget_high_s16(wv)));
+#else
+    int left = 0;
+    int right = 0;
+    for (int n = 0; n < 4; n++) {
+        left += level[n] * apu->pan_weights[n];
+        right += level[4 + n] * apu->pan_weights[4 + n];
+    }
+    *out_left = left;
+    *out_right = right;
+#endif
+}
+
+/**
+ * @brief Add a band-limited step of the given size at the current time
+ */
+static void add_step(GBAudio* apu, int side, int delta) {
+    uint32_t phase = (uint32_t)(((uint64_t)apu->clock_acc * BLEP_PHASES) / GB_CPU_CLOCK);
+    const int16_t* kernel = blep_kernel[phase];
+    int32_t* ring = apu->blep_ring[side];
+    
+    for (int i = 0; i < BLEP_WIDTH; i++) {
+        ring[(apu->blep_pos + i) & BLEP_RING_MASK] += delta * kernel[i];
+    }
+}
+
+/**
+ * @brief Re-mix the channels and record any level change as a step
+ */
+static void update_output(GBAudio* apu) {
+    int level[2] = {0, 0};
+    if (apu->nr52 & 0x80) {
+        mix_channels(apu, &level[0], &level[1]);
+    }
+    for (int side = 0; side < 2; side++) {
+        if (level[side] != apu->amp[side]) {
+            add_step(apu, side, level[side] - apu->amp[side]);
+            apu->amp[side] = level[side];
+        }
+    }
+}
+
+/* ============================================================================
+ * Block Output Stage
+ *
+ * Rendering only integrates the step ring into staged frames. Conversion
+ * to float, the high-pass filter, mono downmix and packing to the output
+ * format then run over whole blocks, vectorized where the stage allows it.
+ * ========================================================================== */
+
+/**
+ * @brief Convert staged step-ring sums to float levels (int16 scale)
+ */
+static void stage_to_float(const int32_t* in, float* out, size_t count) {
+    const float scale = 1.0f / (1 << BLEP_SHIFT);
+    size_t i = 0;
+#if defined(AUDIO_SIMD_SSE2)
+    const __m128 vscale = _mm_set1_ps(scale);
+    for (; i + 4 <= count; i += 4) {
+        __m128 v = _mm_cvtepi32_ps(_mm_loadu_si128((const __m128i*)(in + i)));
+        _mm_storeu_ps(out + i, _mm_mul_ps(v, vscale));
+    }
+#elif defined(AUDIO_SIMD_NEON)
+    for (; i + 4 <= count; i += 4) {
+        vst1q_f32(out + i, vmulq_n_f32(vcvtq_f32_s32(vld1q_s32(in + i)), scale));
+    }
+#endif
+    for (; i < count; i++) {
+        out[i] = (float)in[i] * scale;
+    }
+}
+
+/**
+ * @brief High-pass filter modelling the output capacitor (removes DC)
+ *
+ * The filter is a recurrence, so it runs frame by frame with left and
+ * right in parallel lanes.
+ */
+static void highpass_block(GBAudio* apu, float* buf, size_t frames) {
+#if defined(AUDIO_SIMD_SSE2)
+    const __m128 charge = _mm_set1_ps(apu->hp_charge);
+    __m128 cap = _mm_loadl_pi(_mm_setzero_ps(), (const __m64*)apu->hp_cap);
+    for (size_t i = 0; i < frames; i++) {
+        __m128 in = _mm_loadl_pi(_mm_setzero_ps(), (const __m64*)(buf + i * 2));
+        __m128 out = _mm_sub_ps(in, cap);
+        cap = _mm_sub_ps(in, _mm_mul_ps(out, charge));
+        _mm_storel_pi((__m64*)(buf + i * 2), out);
+    }
+    _mm_storel_pi((__m64*)apu->hp_cap, cap);
+#elif defined(AUDIO_SIMD_NEON)
+    const float32x2_t charge = vdup_n_f32(apu->hp_charge);
+    float32x2_t cap = vld1_f32(apu->hp_cap);
+    for (size_t i = 0; i < frames; i++) {
+        float32x2_t in = vld1_f32(buf + i * 2);
+        float32x2_t out = vsub_f32(in, cap);
+        cap = vmls_f32(in, out, charge);
+        vst1_f32(buf + i * 2, out);
+    }
+    vst1_f32(apu->hp_cap, cap);
+#else
+    const float charge = apu->hp_charge;
+    for (size_t i = 0; i < frames; i++) {
+        for (int side = 0; side < 2; side++) {
+            float in = buf[i * 2 + side];
+            float out = in - apu->hp_cap[side];
+            apu->hp_cap[side] = in - out * charge;
+            buf[i * 2 + side] = out;
         }
     }
+#endif
+    /* Keep a decaying capacitor out of denormal range */
+    for (int side = 0; side < 2; side++) {
+        if (fabsf(apu->hp_cap[side]) < 1e-12f) apu->hp_cap[side] = 0.0f;
+    }
+}
+
+/**
+ * @brief Average interleaved stereo frames to mono, in place
+ */
+static void downmix_block(float* buf, size_t frames) {
+    size_t i = 0;
+#if defined(AUDIO_SIMD_SSE2)
+    const __m128 half = _mm_set1_ps(0.5f);
+    for (; i + 4 <= frames; i += 4) {
+        __m128 a = _mm_loadu_ps(buf + i * 2);
+        __m128 b = _mm_loadu_ps(buf + i * 2 + 4);
+        __m128 left = _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+        __m128 right = _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+        _mm_storeu_ps(buf + i, _mm_mul_ps(_mm_add_ps(left, right), half));
+    }
+#elif defined(AUDIO_SIMD_NEON)
+    for (; i + 4 <= frames; i += 4) {
+        float32x4x2_t lr = vld2q_f32(buf + i * 2);
+        vst1q_f32(buf + i, vmulq_n_f32(vaddq_f32(lr.val[0], lr.val[1]), 0.5f));
+    }
+#endif
+    for (; i < frames; i++) {
+        buf[i] = (buf[i * 2] + buf[i * 2 + 1]) * 0.5f;
+    }
+}
+
+/**
+ * @brief Pack float levels into the output format
+ */
+static void pack_block(const float* in, void* dst, GBSampleFormat format, size_t count) {
+    size_t i = 0;
     
-    /* Channel 2 Stepping */
-    if (apu->ch2.enabled) {
-        uint16_t freq_raw = apu->ch2.nr23 | ((apu->ch2.nr24 & 0x07) << 8);
-        uint32_t period = (2048 - freq_raw) * 4;
-        if (period == 0) period = 4;
-        
-        apu->ch2.timer += cycles;
-        while (apu->ch2.timer >= period) {
-            apu->ch2.timer -= period;
-            apu->ch2.wave_pos = (apu->ch2.wave_pos + 1) & 7;
+    if (format == GB_SAMPLE_F32) {
+        float* out = (float*)dst;
+        const float scale = 1.0f / 32768.0f;
+        /* Clamped like the int16 path: band-limited steps ring and the
+           high-pass filter overshoots past the peak mix */
+#if defined(AUDIO_SIMD_SSE2)
+        const __m128 vscale = _mm_set1_ps(scale);
+        const __m128 vmax = _mm_set1_ps(1.0f);
+        const __m128 vmin = _mm_set1_ps(-1.0f);
+        for (; i + 4 <= count; i += 4) {
+            __m128 v = _mm_mul_ps(_mm_loadu_ps(in + i), vscale);
+            _mm_storeu_ps(out + i, _mm_min_ps(_mm_max_ps(v, vmin), vmax));
+        }
+#elif defined(AUDIO_SIMD_NEON)
+        const float32x4_t vmax = vdupq_n_f32(1.0f);
+        const float32x4_t vmin = vdupq_n_f32(-1.0f);
+        for (; i + 4 <= count; i += 4) {
+            float32x4_t v = vmulq_n_f32(vld1q_f32(in + i), scale);
+            vst1q_f32(out + i, vminq_f32(vmaxq_f32(v, vmin), vmax));
         }
+#endif
+        for (; i < count; i++) {
+            float v = in[i] * scale;
+            if (v > 1.0f) v = 1.0f;
+            if (v < -1.0f) v = -1.0f;
+            out[i] = v;
+        }
+        return;
+    }
+    
+    int16_t* out = (int16_t*)dst;
+#if defined(AUDIO_SIMD_SSE2)
+    /* packs saturates to the int16 range */
+    for (; i + 8 <= count; i += 8) {
+        __m128i lo = _mm_cvtps_epi32(_mm_loadu_ps(in + i));
+        __m128i hi = _mm_cvtps_epi32(_mm_loadu_ps(in + i + 4));
+        _mm_storeu_si128((__m128i*)(out + i), _mm_packs_epi32(lo, hi));
+    }
+#elif defined(AUDIO_SIMD_NEON)
+    for (; i + 8 <= count; i += 8) {
+        int16x4_t lo = vqmovn_s32(vcvtnq_s32_f32(vld1q_f32(in + i)));
+        int16x4_t hi = vqmovn_s32(vcvtnq_s32_f32(vld1q_f32(in + i + 4)));
+        vst1q_s16(out + i, vcombine_s16(lo, hi));
+    }
+#endif
+    for (; i < count; i++) {
+        long v = lrintf(in[i]);
+        if (v > 32767) v = 32767;
+        if (v < -32768) v = -32768;
+        out[i] = (int16_t)v;
     }
+}
+
+/**
+ * @brief Run the staged frames through the output stage into the output block
+ */
+static void process_stage(GBAudio* apu) {
+    size_t frames = apu->stage_count;
+    if (frames == 0) return;
+    
+    stage_to_float(apu->stage, apu->work, frames * 2);
+    if (apu->highpass) highpass_block(apu, apu->work, frames);
+    if (apu->channels == 1) downmix_block(apu->work, frames);
+    
+    size_t offset = apu->out_count * apu->channels;
+    void* dst = (apu->format == GB_SAMPLE_F32) ? (void*)((float*)apu->out + offset)
+                                               : (void*)((int16_t*)apu->out + offset);
+    pack_block(apu->work, dst, apu->format, frames * apu->channels);
+    
+    apu->out_count += frames;
+    apu->stage_count = 0;
+}
 
-    /* Channel 3 Stepping */
-    if (apu->ch3.enabled) {
-        uint16_t freq_raw = apu->ch3.nr33 | ((apu->ch3.nr34 & 0x07) << 8);
-        uint32_t period = (2048 - freq_raw) * 2; /* Wave channel is 2x faster clocking? 65536Hz base */
-        if (period == 0) period = 2;
+/**
+ * @brief Hand the filled part of the output block to the frontend
+ */
+static void flush_block(GBContext* ctx, GBAudio* apu) {
+    process_stage(apu);
+    if (apu->out_count == 0) return;
+    
+    if (ctx->callbacks.on_audio_block) {
+        ctx->callbacks.on_audio_block(ctx, apu->out, apu->out_count);
+    } else {
+        for (size_t i = 0; i < apu->out_count; i++) {
+            int16_t left, right;
+            size_t idx = i * apu->channels;
+            if (apu->format == GB_SAMPLE_F32) {
+                const float* f = (const float*)apu->out;
+                left = (int16_t)(f[idx] * 32767.0f);
+                right = (int16_t)(f[idx + apu->channels - 1] * 32767.0f);
+            } else {
+                const int16_t* v = (const int16_t*)apu->out;
+                left = v[idx];
+                right = v[idx + apu->channels - 1];
+            }
+            gb_audio_callback(ctx, left, right);
+        }
+    }
+    apu->out_count = 0;
+}
 
-        apu->ch3.timer += (cycles); /* TODO: Verify wave timing scalar */
-        while (apu->ch3.timer >= period) {
-            apu->ch3.timer -= period;
-            apu->ch3.wave_pos = (apu->ch3.wave_pos + 1) & 31;
+/**
+ * @brief Integrate the step buffer into the next staged frame
+ */
+static void emit_sample(GBContext* ctx, GBAudio* apu) {
+    int32_t* frame = apu->stage + apu->stage_count * 2;
+    for (int side = 0; side < 2; side++) {
+        int32_t* slot = &apu->blep_ring[side][apu->blep_pos];
+        apu->blep_sum[side] += *slot;
+        *slot = 0;
+        frame[side] = apu->blep_sum[side];
+    }
+    apu->blep_pos = (apu->blep_pos + 1) & BLEP_RING_MASK;
+    
+    /* Stage no more than the output block has room for */
+    size_t room = apu->out_frames - apu->out_count;
+    size_t limit = (room < AUDIO_BLOCK_FRAMES) ? room : AUDIO_BLOCK_FRAMES;
+    if (++apu->stage_count == limit) {
+        process_stage(apu);
+        if (apu->out_count == apu->out_frames) {
+            flush_block(ctx, apu);
         }
     }
+}
 
-    /* Channel 4 Stepping */
-    if (apu->ch4.enabled) {
-        /* Polynomial Counter */
-        uint8_t s = apu->ch4.nr43 >> 4;
-        uint8_t r = apu->ch4.nr43 & 0x07;
-        uint32_t period = NOISE_DIVISORS[r & 7] << s;
-        
-        /* Minimum period is 8 cycles? */
-        if (period < 8) period = 8;
-
-        /* Clock LFSR */
-        /* TODO: This timer logic is simplified, assumes we handle all cycles */
-        /* Normally we'd track residual */
-        /* For noise, we just want to know if we should clock the LFSR */
-        /* Accumulate cycles */
-        static uint32_t ch4_accum = 0; /* Should be in struct, but using static for quick fix */
-        ch4_accum += cycles;
-        
-        while (ch4_accum >= period) {
-            ch4_accum -= period;
-            
-            /* Shift LFSR */
-            uint16_t lfsr = apu->ch4.lfsr;
-            bool xor_res = (lfsr & 1) ^ ((lfsr >> 1) & 1);
-            lfsr >>= 1;
-            lfsr |= (xor_res << 14);
-            if (apu->ch4.nr43 & 0x08) { /* 7-bit mode */
-                lfsr &= ~0x40;
-                lfsr |= (xor_res << 6);
+/**
+ * @brief Render the APU forward by the given number of cycles
+ *
+ * Time jumps from event to event: audible channel edges and the 512 Hz
+ * frame sequencer steps. Output samples falling inside an interval are
+ * emitted first; level changes at its end are then added as band-limited
+ * steps at their exact sub-sample position. Work scales with the number of
+ * output transitions, not with emulated cycles.
+ */
+static void render(GBContext* ctx, GBAudio* apu, uint32_t cycles) {
+    if (apu->silent) {
+        /* Only the frame sequencer (length, envelope, sweep) is visible
+           to the CPU, through NR52 and register reads; channel edges and
+           samples are skipped. Powered off, nothing but the output runs. */
+        if (!(apu->nr52 & 0x80)) return;
+        while (cycles > 0) {
+            uint32_t step = apu->fs_at - apu->now;
+            if (step > cycles) step = cycles;
+            apu->now += step;
+            cycles -= step;
+            if (apu->fs_at == apu->now) {
+                apu->fs_at += FS_PERIOD;
+                settle_channels(apu);
+                clock_frame_sequencer(apu);
             }
-            apu->ch4.lfsr = lfsr;
         }
+        return;
     }
     
-    if (apu->sample_timer >= apu->sample_period) {
-        apu->sample_timer -= apu->sample_period;
-        
-        int16_t left = 0;
-        int16_t right = 0;
-        
-        /* Channel 1 Output */
-        if (apu->ch1.enabled && (apu->ch1.nr12 & 0xF0)) { // DAC ON
-             int duty = (apu->ch1.nr11 >> 6) & 3;
-             int output = DUTY_CYCLES[duty][apu->ch1.wave_pos];
-             
-             if (output) {
-                 int vol = apu->ch1.volume;
-                 if (apu->nr51 & 0x01) right += vol;
-                 if (apu->nr51 & 0x10) left += vol;
-             }
+    if (!(apu->nr52 & 0x80)) {
+        /* Powered off: channels and frame sequencer are frozen, but the
+           output keeps running so the stream stays in step with emulation */
+        while (cycles > 0) {
+            uint32_t step = cycles < FS_PERIOD ? cycles : FS_PERIOD;
+            apu->clock_acc += step * apu->sample_rate;
+            while (apu->clock_acc >= GB_CPU_CLOCK) {
+                apu->clock_acc -= GB_CPU_CLOCK;
+                emit_sample(ctx, apu);
+            }
+            cycles -= step;
         }
+        return;
+    }
+    
+    while (cycles > 0) {
+        /* Never more than FS_PERIOD, which keeps clock_acc in range */
+        uint32_t step = next_event(apu);
+        if (step > cycles) step = cycles;
         
-        /* Channel 2 Output */
-        if (apu->ch2.enabled && (apu->ch2.nr22 & 0xF0)) { // DAC ON
-             int duty = (apu->ch2.nr21 >> 6) & 3;
-             int output = DUTY_CYCLES[duty][apu->ch2.wave_pos];
-             
-             if (output) {
-                 int vol = apu->ch2.volume;
-                 if (apu->nr51 & 0x02) right += vol;
-                 if (apu->nr51 & 0x20) left += vol;
-             }
+        apu->clock_acc += step * apu->sample_rate;
+        while (apu->clock_acc >= GB_CPU_CLOCK) {
+            apu->clock_acc -= GB_CPU_CLOCK;
+            emit_sample(ctx, apu);
         }
-
-        /* Channel 3 Output */
-        if (apu->ch3.enabled && (apu->ch3.nr30 & 0x80)) { // DAC ON
-             /* Get wave sample (4-bit) */
-             uint8_t byte = apu->ch3.wave_ram[apu->ch3.wave_pos / 2];
-             uint8_t sample = (apu->ch3.wave_pos & 1) ? (byte & 0x0F) : (byte >> 4);
-             
-             /* Apply volume shift */
-             uint8_t vol_code = (apu->ch3.nr32 >> 5) & 3;
-             switch (vol_code) {
-                 case 0: sample = 0; break; /* Mute */
-                 case 1: break; /* 100% */
-                 case 2: sample >>= 1; break; /* 50% */
-                 case 3: sample >>= 2; break; /* 25% */
-             }
-             
-             if (apu->nr51 & 0x04) right += sample;
-             if (apu->nr51 & 0x40) left += sample;
+        
+        apu->now += step;
+        cycles -= step;
+        
+        bool changed = false;
+        for (int n = 0; n < 4; n++) {
+            if (apu->edge_at[n] == apu->now) {
+                settle_channel(apu, n);
+                schedule_channel(apu, n);
+                changed = true;
+            }
         }
-
-        /* Channel 4 Output */
-        if (apu->ch4.enabled && (apu->ch4.nr42 & 0xF0)) { // DAC ON
-             bool output = !(apu->ch4.lfsr & 1); /* Output is inverted bit 0 */
-             
-             if (output) {
-                 int vol = apu->ch4.volume;
-                 if (apu->nr51 & 0x08) right += vol;
-                 if (apu->nr51 & 0x80) left += vol;
-             }
+        if (apu->fs_at == apu->now) {
+            apu->fs_at += FS_PERIOD;
+            settle_channels(apu);
+            clock_frame_sequencer(apu);
+            schedule_channels(apu);
+            changed = true;
         }
         
-        /* Master Volume / Scaling */
-        /* Currently values are 0-15 per channel, mixed. Max approx 60. */
-        /* Scale to int16 range */
-        /* Max possible value: 15 * 4 * 8 = 480. 
-           32767 / 480 = 68. 
-           Using 64 provides good volume without clipping. */
-        int vol_l = (apu->nr50 >> 4) & 7;
-        int vol_r = (apu->nr50 & 7);
-        
-        left = left * (vol_l + 1) * 64;
-        right = right * (vol_r + 1) * 64;
+        if (changed) update_output(apu);
+    }
+}
 
-        gb_audio_callback(ctx, left, right);
+static void render_to(GBContext* ctx, GBAudio* apu, uint32_t cycles) {
+    uint32_t elapsed = cycles - apu->last_cycles;
+    apu->last_cycles = cycles;
+    if (elapsed > 0) {
+        render(ctx, apu, elapsed);
     }
 }
 
-void gb_audio_div_reset(void* apu_ptr) {
-    if (!apu_ptr) return;
-    GBAudio* apu = (GBAudio*)apu_ptr;
+void gb_audio_sync(GBContext* ctx) {
+    GBAudio* apu = (GBAudio*)ctx->apu;
+    if (!apu) return;
+    
+    /* Threaded: let the worker finish queued writes, then render here */
+    thread_drain(apu);
+    render_to(ctx, apu, ctx->cycles);
+}
+
+void gb_audio_end_frame(GBContext* ctx) {
+    GBAudio* apu = (GBAudio*)ctx->apu;
+    if (!apu) return;
+    
+    if (apu->thread) {
+        thread_push(apu, ctx->cycles, AUDIO_EVENT_FRAME_END, 0);
+        return;
+    }
+    gb_audio_sync(ctx);
+    flush_block(ctx, apu);
+}
+
+void gb_audio_set_buffer(GBContext* ctx, void* samples, size_t frames) {
+    GBAudio* apu = (GBAudio*)ctx->apu;
+    if (!apu) return;
+    
+    /* Samples already in the old block go out first */
+    gb_audio_sync(ctx);
+    flush_block(ctx, apu);
+    
+    if (samples && frames > 0) {
+        apu->out = samples;
+        apu->out_frames = frames;
+    } else {
+        apu->out = apu->internal_block;
+        apu->out_frames = AUDIO_BLOCK_FRAMES;
+    }
+}
+
+bool gb_audio_set_format(GBContext* ctx, uint32_t sample_rate, GBSampleFormat format, int channels) {
+    GBAudio* apu = (GBAudio*)ctx->apu;
+    if (!apu) return false;
+    if (sample_rate < 8000 || sample_rate > 192000) return false;
+    if (channels != 1 && channels != 2) return false;
+    if (format != GB_SAMPLE_S16 && format != GB_SAMPLE_F32) return false;
+    
+    gb_audio_sync(ctx);
+    flush_block(ctx, apu);
+    
+    apu->sample_rate = sample_rate;
+    apu->format = format;
+    apu->channels = channels;
+    /* clock_acc is a fraction of GB_CPU_CLOCK whatever the rate, so a
+       rate change (e.g. dynamic rate control) keeps sample phase */
+    apu->hp_charge = highpass_charge(sample_rate);
+    return true;
+}
+
+void gb_audio_set_highpass(GBContext* ctx, bool enabled) {
+    GBAudio* apu = (GBAudio*)ctx->apu;
+    if (!apu || apu->highpass == enabled) return;
+    
+    gb_audio_sync(ctx);
+    flush_block(ctx, apu);
+    
+    apu->highpass = enabled;
+    /* Start charged to the current level so enabling doesn't click */
+    for (int side = 0; side < 2; side++) {
+        apu->hp_cap[side] = (float)apu->blep_sum[side] / (1 << BLEP_SHIFT);
+    }
+}
+
+void gb_audio_div_reset(GBContext* ctx) {
+    GBAudio* apu = (GBAudio*)ctx->apu;
+    if (!apu) return;
+    
+    if (apu->thread) {
+        thread_push(apu, ctx->cycles, AUDIO_EVENT_DIV_RESET, 0);
+        return;
+    }
+    gb_audio_sync(ctx);  /* Render up to the reset first */
     
     /* When DIV is reset, the internal counter for the Frame Sequencer is NOT affected 
        directly, but the way Game Boy hardware derives the 512 Hz clock is from 
@@ -639,5 +1500,233 @@ void gb_audio_div_reset(void* apu_ptr) {
        Writing to DIV resets internal counter to 0. 
        So we should reset our accumulation timer.
     */
-    apu->fs_timer = 0;
+    apu->fs_at = apu->now + FS_PERIOD;
+}
+
+void gb_audio_set_silent(GBContext* ctx, bool silent) {
+    GBAudio* apu = (GBAudio*)ctx->apu;
+    if (!apu || apu->silent == silent) return;
+    
+    gb_audio_sync(ctx);
+    if (silent) flush_block(ctx, apu);
+    apu->silent = silent;
+    if (!silent) {
+        /* Edges went unscheduled while silent */
+        settle_channels(apu);
+        schedule_channels(apu);
+        update_output(apu);
+    }
+}
+
+/* ============================================================================
+ * Save State
+ * ========================================================================== */
+
+void gb_audio_serialize(GBContext* ctx, GBStateCursor* c) {
+    GBAudio* apu = (GBAudio*)ctx->apu;
+    if (!apu) return;
+
+    /* The worker must not be rendering while its state is copied */
+    if (c->pos) thread_drain(apu);
+
+    GB_STATE_FIELD(c, apu->ch1);
+    GB_STATE_FIELD(c, apu->ch2);
+    GB_STATE_FIELD(c, apu->ch3);
+    GB_STATE_FIELD(c, apu->ch4);
+    GB_STATE_FIELD(c, apu->nr50);
+    GB_STATE_FIELD(c, apu->nr51);
+    GB_STATE_FIELD(c, apu->nr52);
+    GB_STATE_FIELD(c, apu->pan_weights);
+    GB_STATE_FIELD(c, apu->fs_step);
+    GB_STATE_FIELD(c, apu->now);
+    GB_STATE_FIELD(c, apu->fs_at);
+    GB_STATE_FIELD(c, apu->settled_at);
+    GB_STATE_FIELD(c, apu->edge_at);
+    GB_STATE_FIELD(c, apu->last_cycles);
+    GB_STATE_FIELD(c, apu->clock_acc);
+    GB_STATE_FIELD(c, apu->amp);
+    GB_STATE_FIELD(c, apu->blep_ring);
+    GB_STATE_FIELD(c, apu->blep_sum);
+    GB_STATE_FIELD(c, apu->blep_pos);
+    GB_STATE_FIELD(c, apu->hp_cap);
+
+    if (c->load && c->pos) {
+        /* Samples not yet delivered belong to the abandoned timeline */
+        apu->stage_count = 0;
+        apu->out_count = 0;
+    }
+}
+
+/* ============================================================================
+ * Audio Thread
+ *
+ * Optionally the APU runs on its own thread. The emulation thread only
+ * appends timestamped register writes (and DIV resets and frame ends) to a
+ * single-producer/single-consumer queue. The worker renders up to each
+ * event's timestamp and applies it, so the output is the same as rendering
+ * inline. It is woken once per frame, or early if the queue fills.
+ *
+ * Register reads and configuration changes wait for the queue to drain and
+ * then run on the calling thread. Audio callbacks fire on the worker.
+ * ========================================================================== */
+
+typedef struct {
+    uint32_t cycles;          /* ctx->cycles when the event happened */
+    uint16_t addr;            /* Register, or AUDIO_EVENT_* */
+    uint8_t value;
+} AudioEvent;
+
+struct AudioThread {
+    AudioEvent events[AUDIO_QUEUE_SIZE];
+    _Atomic uint32_t head;    /* Next slot the emulation thread fills */
+    _Atomic uint32_t tail;    /* Next event the worker applies */
+    
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t wake;      /* Events were queued */
+    pthread_cond_t idle;      /* The queue ran empty */
+    bool quit;
+    
+    GBContext* ctx;
+};
+
+static void thread_apply(GBContext* ctx, GBAudio* apu, const AudioEvent* ev) {
+    render_to(ctx, apu, ev->cycles);
+    
+    switch (ev->addr) {
+        case AUDIO_EVENT_FRAME_END:
+            flush_block(ctx, apu);
+            break;
+        case AUDIO_EVENT_DIV_RESET:
+            apu->fs_at = apu->now + FS_PERIOD;
+            break;
+        default:
+            apply_write(apu, ev->addr, ev->value);
+            break;
+    }
+}
+
+static void* audio_thread_main(void* arg) {
+    GBAudio* apu = (GBAudio*)arg;
+    struct AudioThread* t = apu->thread;
+    
+    for (;;) {
+        pthread_mutex_lock(&t->lock);
+        while (atomic_load_explicit(&t->head, memory_order_acquire) ==
+               atomic_load_explicit(&t->tail, memory_order_relaxed) && !t->quit) {
+            pthread_cond_broadcast(&t->idle);
+            pthread_cond_wait(&t->wake, &t->lock);
+        }
+        bool quit = t->quit;
+        pthread_mutex_unlock(&t->lock);
+        if (quit) break;
+        
+        uint32_t tail = atomic_load_explicit(&t->tail, memory_order_relaxed);
+        uint32_t head = atomic_load_explicit(&t->head, memory_order_acquire);
+        while (tail != head) {
+            thread_apply(t->ctx, apu, &t->events[tail & AUDIO_QUEUE_MASK]);
+            tail++;
+            atomic_store_explicit(&t->tail, tail, memory_order_release);
+            if (tail == head) head = atomic_load_explicit(&t->head, memory_order_acquire);
+        }
+    }
+    return NULL;
+}
+
+static void thread_wake(struct AudioThread* t) {
+    pthread_mutex_lock(&t->lock);
+    pthread_cond_signal(&t->wake);
+    pthread_mutex_unlock(&t->lock);
+}
+
+/**
+ * @brief Block until the worker has applied every queued event
+ *
+ * Afterwards the worker is asleep and the APU may be used directly until
+ * the next push.
+ */
+static void thread_drain(GBAudio* apu) {
+    struct AudioThread* t = apu->thread;
+    if (!t) return;
+    
+    pthread_mutex_lock(&t->lock);
+    if (atomic_load_explicit(&t->tail, memory_order_acquire) !=
+        atomic_load_explicit(&t->head, memory_order_relaxed)) {
+        pthread_cond_signal(&t->wake);
+        while (atomic_load_explicit(&t->tail, memory_order_acquire) !=
+               atomic_load_explicit(&t->head, memory_order_relaxed)) {
+            pthread_cond_wait(&t->idle, &t->lock);
+        }
+    }
+    pthread_mutex_unlock(&t->lock);
+}
+
+static void thread_push(GBAudio* apu, uint32_t cycles, uint16_t addr, uint8_t value) {
+    struct AudioThread* t = apu->thread;
+    uint32_t head = atomic_load_explicit(&t->head, memory_order_relaxed);
+    
+    if (head - atomic_load_explicit(&t->tail, memory_order_acquire) == AUDIO_QUEUE_SIZE) {
+        thread_drain(apu);  /* Full: let the worker catch up */
+    }
+    
+    AudioEvent* ev = &t->events[head & AUDIO_QUEUE_MASK];
+    ev->cycles = cycles;
+    ev->addr = addr;
+    ev->value = value;
+    atomic_store_explicit(&t->head, head + 1, memory_order_release);
+    
+    if (addr == AUDIO_EVENT_FRAME_END) thread_wake(t);
+}
+
+static void thread_stop(GBAudio* apu) {
+    struct AudioThread* t = apu->thread;
+    if (!t) return;
+    
+    thread_drain(apu);
+    pthread_mutex_lock(&t->lock);
+    t->quit = true;
+    pthread_cond_signal(&t->wake);
+    pthread_mutex_unlock(&t->lock);
+    pthread_join(t->thread, NULL);
+    
+    pthread_cond_destroy(&t->idle);
+    pthread_cond_destroy(&t->wake);
+    pthread_mutex_destroy(&t->lock);
+    free(t);
+    apu->thread = NULL;
+}
+
+bool gb_audio_set_threaded(GBContext* ctx, bool enabled) {
+    GBAudio* apu = (GBAudio*)ctx->apu;
+    if (!apu) return false;
+    if (enabled == (apu->thread != NULL)) return true;
+    
+    if (!enabled) {
+        thread_stop(apu);
+        return true;
+    }
+    
+    /* The worker picks up from the current time */
+    gb_audio_sync(ctx);
+    
+    struct AudioThread* t = (struct AudioThread*)calloc(1, sizeof(struct AudioThread));
+    if (!t) return false;
+    t->ctx = ctx;
+    atomic_init(&t->head, 0);
+    atomic_init(&t->tail, 0);
+    pthread_mutex_init(&t->lock, NULL);
+    pthread_cond_init(&t->wake, NULL);
+    pthread_cond_init(&t->idle, NULL);
+    
+    apu->thread = t;
+    if (pthread_create(&t->thread, NULL, audio_thread_main, apu) != 0) {
+        fprintf(stderr, "[APU] Failed to start audio thread\n");
+        pthread_cond_destroy(&t->idle);
+        pthread_cond_destroy(&t->wake);
+        pthread_mutex_destroy(&t->lock);
+        free(t);
+        apu->thread = NULL;
+        return false;
+    }
+    return true;
 }
@@ -2,11 +2,19 @@
 #include "ppu.h"
 #include "audio.h"
 #include "platform_sdl.h"
+#include "savestate.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include "gbrt_debug.h"
 
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 /* ============================================================================
  * Definitions
  * ========================================================================== */
@@ -32,6 +40,9 @@ static char* gbrt_trace_filename = NULL;
  * Context Management
  * ========================================================================== */
 
+static size_t cart_ram_size(uint8_t type, uint8_t code);
+static void release_eram(GBContext* ctx);
+
 GBContext* gb_context_create(const GBConfig* config) {
     GBContext* ctx = (GBContext*)calloc(1, sizeof(GBContext));
     if (!ctx) return NULL;
@@ -54,6 +65,7 @@ GBContext* gb_context_create(const GBConfig* config) {
     }
     
     ctx->apu = gb_audio_create();
+    ctx->cpu_clock_percent = 100;
     gb_context_reset(ctx, true);
     (void)config;
 
@@ -71,14 +83,20 @@ GBContext* gb_context_create(const GBConfig* config) {
 void gb_context_destroy(GBContext* ctx) {
     if (!ctx) return;
     if (ctx->trace_file) fclose((FILE*)ctx->trace_file);
+    if (ctx->ppu) {
+        /* Stop the render thread while VRAM is still around */
+        if (ctx->vram) ppu_set_deferred((GBPPU*)ctx->ppu, ctx, false);
+        free(ctx->ppu);
+    }
     free(ctx->wram);
     free(ctx->vram);
     free(ctx->oam);
     free(ctx->hram);
     free(ctx->io);
-    if (ctx->ppu) free(ctx->ppu);
     if (ctx->apu) gb_audio_destroy(ctx->apu);
+    gb_set_run_ahead(ctx, 0);
     if (ctx->rom) free(ctx->rom);
+    release_eram(ctx);
     free(ctx);
 }
 
@@ -98,6 +116,10 @@ void gb_context_reset(GBContext* ctx, bool skip_bootrom) {
     ctx->halted = 0;
     ctx->stopped = 0;
     
+    /* Reset joypad state (nothing held) */
+    ctx->last_joypad = 0xFF;
+    ctx->joypad_polled = false;
+    
     /* Reset RTC state */
     ctx->rtc.s = 0;
     ctx->rtc.m = 0;
@@ -171,9 +193,241 @@ bool gb_context_load_rom(GBContext* ctx, const uint8_t* data, size_t size) {
     if (!ctx->rom) return false;
     memcpy(ctx->rom, data, size);
     ctx->rom_size = size;
+    
+    /* Cartridge RAM as declared by the header */
+    release_eram(ctx);
+    if (size > 0x149) {
+        ctx->mbc_type = data[0x147];
+        ctx->eram_size = cart_ram_size(data[0x147], data[0x149]);
+        if (ctx->eram_size) {
+            ctx->eram = (uint8_t*)calloc(1, ctx->eram_size);
+            if (!ctx->eram) ctx->eram_size = 0;
+        }
+    }
+    return true;
+}
+
+/* ============================================================================
+ * Cartridge RAM
+ * ========================================================================== */
+
+/**
+ * @brief RAM size from the cartridge type (0x147) and RAM size (0x149) bytes
+ */
+static size_t cart_ram_size(uint8_t type, uint8_t code) {
+    /* MBC2 has 512 half-bytes built in and declares no RAM */
+    if (type == 0x05 || type == 0x06) return 0x200;
+    switch (code) {
+        case 0x01: return 0x800;
+        case 0x02: return 0x2000;
+        case 0x03: return 0x8000;
+        case 0x04: return 0x20000;
+        case 0x05: return 0x10000;
+        default:   return 0;
+    }
+}
+
+bool gb_cart_has_battery(const GBContext* ctx) {
+    switch (ctx->mbc_type) {
+        case 0x03: case 0x06: case 0x09: case 0x0D: case 0x0F: case 0x10:
+        case 0x13: case 0x1B: case 0x1E: case 0x22: case 0xFF:
+            return true;
+        default:
+            return false;
+    }
+}
+
+#ifdef _WIN32
+/**
+ * @brief Without mmap, persist the whole RAM when the context goes away
+ */
+static void write_save(GBContext* ctx) {
+    FILE* f = fopen(ctx->save_path, "wb");
+    if (!f || fwrite(ctx->eram, 1, ctx->eram_size, f) != ctx->eram_size) {
+        fprintf(stderr, "[GBRT] Cannot write save file %s\n", ctx->save_path);
+    }
+    if (f) fclose(f);
+}
+#endif
+
+static void release_eram(GBContext* ctx) {
+    if (ctx->eram) {
+#ifndef _WIN32
+        if (ctx->eram_mapped) {
+            munmap(ctx->eram, ctx->eram_size);  /* Dirty pages still reach the file */
+        } else {
+            free(ctx->eram);
+        }
+#else
+        if (ctx->save_path) write_save(ctx);
+        free(ctx->eram);
+#endif
+    }
+    free(ctx->save_path);
+    ctx->eram = NULL;
+    ctx->eram_size = 0;
+    ctx->eram_mapped = false;
+    ctx->save_path = NULL;
+}
+
+bool gb_context_attach_save(GBContext* ctx, const char* path) {
+    if (!ctx->eram || ctx->eram_mapped || ctx->save_path) return false;
+    
+#ifndef _WIN32
+    int fd = open(path, O_RDWR | O_CREAT, 0644);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        fprintf(stderr, "[GBRT] Cannot open save file %s\n", path);
+        if (fd >= 0) close(fd);
+        return false;
+    }
+    bool fresh = st.st_size == 0;
+    if ((size_t)st.st_size < ctx->eram_size && ftruncate(fd, (off_t)ctx->eram_size) != 0) {
+        fprintf(stderr, "[GBRT] Cannot extend save file %s\n", path);
+        close(fd);
+        return false;
+    }
+    void* map = mmap(NULL, ctx->eram_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        fprintf(stderr, "[GBRT] Cannot map save file %s\n", path);
+        return false;
+    }
+    /* A new file starts from whatever RAM holds now */
+    if (fresh) memcpy(map, ctx->eram, ctx->eram_size);
+    free(ctx->eram);
+    ctx->eram = (uint8_t*)map;
+    ctx->eram_mapped = true;
+#else
+    FILE* f = fopen(path, "rb");
+    if (f) {
+        size_t got = fread(ctx->eram, 1, ctx->eram_size, f);
+        (void)got;  /* A short file leaves the rest of RAM as is */
+        fclose(f);
+    }
+#endif
+    ctx->save_path = (char*)malloc(strlen(path) + 1);
+    if (ctx->save_path) strcpy(ctx->save_path, path);
     return true;
 }
 
+/* ============================================================================
+ * Save State
+ * ========================================================================== */
+
+/**
+ * @brief Copy back only the VRAM that differs, updating the tile cache as writes would
+ *
+ * A rollback undoes a few frames, which rarely touch more than a handful
+ * of tiles; the rest of the cache and the drawn lines stay valid.
+ */
+static void rollback_vram(GBContext* ctx, const uint8_t* saved) {
+    for (uint32_t block = 0; block < VRAM_SIZE * 2; block += 64) {
+        if (memcmp(ctx->vram + block, saved + block, 64) == 0) continue;
+        for (uint32_t addr = block; addr < block + 64; addr += 2) {
+            if (ctx->vram[addr] == saved[addr] && ctx->vram[addr + 1] == saved[addr + 1]) continue;
+            ctx->vram[addr] = saved[addr];
+            ctx->vram[addr + 1] = saved[addr + 1];
+            /* One call covers the tile row, or the tilemap row, of both bytes */
+            if (ctx->ppu) ppu_vram_write((GBPPU*)ctx->ppu, ctx->vram, addr / VRAM_SIZE, addr % VRAM_SIZE);
+        }
+    }
+}
+
+void gb_context_serialize(GBContext* ctx, GBStateCursor* c) {
+    /* CPU */
+    GB_STATE_FIELD(c, ctx->af);
+    GB_STATE_FIELD(c, ctx->bc);
+    GB_STATE_FIELD(c, ctx->de);
+    GB_STATE_FIELD(c, ctx->hl);
+    GB_STATE_FIELD(c, ctx->sp);
+    GB_STATE_FIELD(c, ctx->pc);
+    GB_STATE_FIELD(c, ctx->f_z);
+    GB_STATE_FIELD(c, ctx->f_n);
+    GB_STATE_FIELD(c, ctx->f_h);
+    GB_STATE_FIELD(c, ctx->f_c);
+    GB_STATE_FIELD(c, ctx->ime);
+    GB_STATE_FIELD(c, ctx->ime_pending);
+    GB_STATE_FIELD(c, ctx->halted);
+    GB_STATE_FIELD(c, ctx->stopped);
+    GB_STATE_FIELD(c, ctx->halt_bug);
+    GB_STATE_FIELD(c, ctx->dma);
+
+    /* Banking and MBC */
+    GB_STATE_FIELD(c, ctx->rom_bank);
+    GB_STATE_FIELD(c, ctx->ram_bank);
+    GB_STATE_FIELD(c, ctx->wram_bank);
+    GB_STATE_FIELD(c, ctx->vram_bank);
+    GB_STATE_FIELD(c, ctx->ram_enabled);
+    GB_STATE_FIELD(c, ctx->mbc_mode);
+    GB_STATE_FIELD(c, ctx->rom_bank_upper);
+    GB_STATE_FIELD(c, ctx->rtc_mode);
+    GB_STATE_FIELD(c, ctx->rtc_reg);
+    GB_STATE_FIELD(c, ctx->rtc);
+
+    /* Timing; cpu_clock_percent is a host setting and stays as configured */
+    GB_STATE_FIELD(c, ctx->cycles);
+    GB_STATE_FIELD(c, ctx->frame_cycles);
+    GB_STATE_FIELD(c, ctx->last_sync_cycles);
+    GB_STATE_FIELD(c, ctx->frame_done);
+    GB_STATE_FIELD(c, ctx->cpu_clock_remainder);
+    GB_STATE_FIELD(c, ctx->div_counter);
+    GB_STATE_FIELD(c, ctx->last_joypad);
+    GB_STATE_FIELD(c, ctx->joypad_polled);
+
+    /* Memory */
+    gb_state_field(c, ctx->wram, WRAM_BANK_SIZE * 8);
+    if (c->rollback && c->load && c->pos) rollback_vram(ctx, c->pos);
+    gb_state_field(c, ctx->vram, VRAM_SIZE * 2);
+    gb_state_field(c, ctx->oam, OAM_SIZE);
+    gb_state_field(c, ctx->hram, HRAM_SIZE);
+    gb_state_field(c, ctx->io, IO_SIZE + 1);
+    if (ctx->eram) gb_state_field(c, ctx->eram, ctx->eram_size);
+}
+
+/* ============================================================================
+ * Joypad
+ * ========================================================================== */
+
+/**
+ * @brief P10-P13 input lines for a button state and JOYP select bits
+ */
+static uint8_t joypad_lines(uint8_t state, uint8_t joyp) {
+    uint8_t lines = 0x0F;
+    if (!(joyp & 0x10)) lines &= state & 0x0F;  /* D-pad */
+    if (!(joyp & 0x20)) lines &= state >> 4;    /* Buttons */
+    return lines;
+}
+
+/**
+ * @brief Latch a new button state, raising the joypad interrupt on a
+ *        high-to-low transition of any selected input line
+ */
+static void joypad_update(GBContext* ctx, uint8_t state) {
+    uint8_t before = joypad_lines(ctx->last_joypad, ctx->io[0x00]);
+    uint8_t after = joypad_lines(state, ctx->io[0x00]);
+    if (before & ~after) ctx->io[0x0F] |= 0x10;
+    ctx->last_joypad = state;
+}
+
+/**
+ * @brief Button state, buttons in the high nibble and d-pad in the low (active low)
+ *
+ * With a get_joypad callback the input source is polled on the first JOYP
+ * read of each frame rather than once between frames; later reads in the
+ * same frame hit the cache.
+ */
+static uint8_t joypad_state(GBContext* ctx) {
+    if (!ctx->callbacks.get_joypad) {
+        return (uint8_t)((g_joypad_buttons & 0x0F) << 4 | (g_joypad_dpad & 0x0F));
+    }
+    if (!ctx->joypad_polled) {
+        ctx->joypad_polled = true;
+        joypad_update(ctx, ctx->callbacks.get_joypad(ctx));
+    }
+    return ctx->last_joypad;
+}
+
 /* ============================================================================
  * Memory Access
  * ========================================================================== */
@@ -261,10 +515,7 @@ uint8_t gb_read8(GBContext* ctx, uint16_t addr) {
              // DBG_GENERAL("Reading JOYP 0xFF00");
              uint8_t joyp = ctx->io[0x00];
              // Bits 6-7 always 1. Bits 4-5 return what was written.
-             uint8_t res = 0xC0 | (joyp & 0x30) | 0x0F;
-             if (!(joyp & 0x10)) res &= g_joypad_dpad;
-             if (!(joyp & 0x20)) res &= g_joypad_buttons;
-             return res;
+             return 0xC0 | (joyp & 0x30) | joypad_lines(joypad_state(ctx), joyp);
         }
         if (addr == 0xFF04) return (uint8_t)(ctx->div_counter >> 8);
         if (addr >= 0xFF40 && addr <= 0xFF4B) return ppu_read_register((GBPPU*)ctx->ppu, addr);
@@ -413,7 +664,12 @@ void gb_write8(GBContext* ctx, uint16_t addr, uint8_t value) {
         /* VRAM Write - Check STAT mode 3 */
         // if ((ctx->io[0x41] & 3) == 3) return;
         
-        ctx->vram[(ctx->vram_bank * VRAM_SIZE) + (addr - 0x8000)] = value;
+        uint16_t offset = addr - 0x8000;
+        uint8_t* cell = &ctx->vram[(ctx->vram_bank * VRAM_SIZE) + offset];
+        if (*cell != value) {
+            *cell = value;
+            if (ctx->ppu) ppu_vram_write((GBPPU*)ctx->ppu, ctx->vram, ctx->vram_bank, offset);
+        }
         return;
     }
     if (addr < 0xC000) {
@@ -462,6 +718,7 @@ void gb_write8(GBContext* ctx, uint16_t addr, uint8_t value) {
         // if (stat == 2 || stat == 3) return;
         
         ctx->oam[addr - 0xFE00] = value; 
+        if (ctx->ppu) ppu_oam_write((GBPPU*)ctx->ppu);
         return; 
     }
     if (addr < 0xFF00) return;
@@ -472,7 +729,7 @@ void gb_write8(GBContext* ctx, uint16_t addr, uint8_t value) {
             uint16_t old_div = ctx->div_counter;
             ctx->div_counter = 0; 
             ctx->io[0x04] = 0; /* Update register view immediately */
-            if (ctx->apu) gb_audio_div_reset(ctx->apu);
+            if (ctx->apu) gb_audio_div_reset(ctx);
             
             /* DIV Reset Glitch: 
              * If the selected bit for TIMA is 1 in old_div and becomes 0 (it does, since div is 0),
@@ -509,6 +766,12 @@ void gb_write8(GBContext* ctx, uint16_t addr, uint8_t value) {
              ctx->dma.active = 1;
              return;
         }
+        if (addr == 0xFF00 && ctx->callbacks.get_joypad) {
+            /* Selecting a row with a button held pulls its line low */
+            uint8_t before = joypad_lines(ctx->last_joypad, ctx->io[0x00]);
+            uint8_t after = joypad_lines(ctx->last_joypad, value);
+            if (before & ~after) ctx->io[0x0F] |= 0x10;
+        }
         if (addr == 0xFF02 && (value & 0x80)) {
             printf("%c", ctx->io[0x01]); fflush(stdout);
             ctx->io[0x0F] |= 0x08;
@@ -707,6 +970,24 @@ void gb_add_cycles(GBContext* ctx, uint32_t cycles) {
     ctx->frame_cycles += cycles;
 }
 
+void gb_set_cpu_overclock(GBContext* ctx, uint32_t percent) {
+    if (percent < 100) percent = 100;
+    ctx->cpu_clock_percent = percent;
+    ctx->cpu_clock_remainder = 0;
+}
+
+/**
+ * Convert CPU cycles to hardware cycles when overclocked.
+ * The CPU runs faster than the rest of the machine, so each instruction
+ * only advances the PPU/APU/timer timeline by cycles * 100 / percent.
+ * The fractional part is carried over so no time is lost.
+ */
+static inline uint32_t gb_scale_cpu_cycles(GBContext* ctx, uint32_t cycles) {
+    uint32_t scaled = cycles * 100 + ctx->cpu_clock_remainder;
+    ctx->cpu_clock_remainder = scaled % ctx->cpu_clock_percent;
+    return scaled / ctx->cpu_clock_percent;
+}
+
 
 
 static void gb_rtc_tick(GBContext* ctx, uint32_t cycles) {
@@ -747,6 +1028,7 @@ static void gb_rtc_tick(GBContext* ctx, uint32_t cycles) {
  */
 static void gb_dma_tick(GBContext* ctx, uint32_t cycles) {
     if (!ctx->dma.active) return;
+    uint8_t start_progress = ctx->dma.progress;
     
     /* Process DMA cycles */
     while (cycles > 0 && ctx->dma.active) {
@@ -772,7 +1054,8 @@ static void gb_dma_tick(GBContext* ctx, uint32_t cycles) {
                 byte = ctx->vram[src_addr - 0x8000];
             } else if (src_addr < 0xC000) {
                 /* External RAM */
-                byte = ctx->eram ? ctx->eram[(ctx->ram_bank * 0x2000) + (src_addr - 0xA000)] : 0xFF;
+                uint32_t eram_addr = ((uint32_t)ctx->ram_bank * 0x2000) + (src_addr - 0xA000);
+                byte = (ctx->eram && eram_addr < ctx->eram_size) ? ctx->eram[eram_addr] : 0xFF;
             } else if (src_addr < 0xE000) {
                 /* WRAM */
                 if (src_addr < 0xD000) {
@@ -792,6 +1075,10 @@ static void gb_dma_tick(GBContext* ctx, uint32_t cycles) {
             ctx->dma.active = 0;
         }
     }
+    
+    if (ctx->dma.progress != start_progress && ctx->ppu) {
+        ppu_oam_write((GBPPU*)ctx->ppu);
+    }
 }
 
 void gb_tick(GBContext* ctx, uint32_t cycles) {
@@ -811,6 +1098,15 @@ void gb_tick(GBContext* ctx, uint32_t cycles) {
         fprintf(stderr, "[TICK] Cycles: %u, PC: 0x%04X, IME: %d, IF: 0x%02X, IE: 0x%02X\n", 
                 ctx->cycles, ctx->pc, ctx->ime, ctx->io[0x0F], ctx->io[0x80]);
     }
+    
+    /* Overclock: HALT waits on hardware, so only charge executed instructions at the faster rate */
+    if (ctx->cpu_clock_percent > 100 && !ctx->halted) {
+        cycles = gb_scale_cpu_cycles(ctx, cycles);
+        if (cycles == 0) {
+            if (ctx->ime_pending) { ctx->ime = 1; ctx->ime_pending = 0; }
+            return;
+        }
+    }
     gb_add_cycles(ctx, cycles);
     
     /* RTC Tick */
@@ -878,7 +1174,6 @@ void gb_tick(GBContext* ctx, uint32_t cycles) {
         gb_sync(ctx);
         if (ctx->frame_done || (ctx->ime && (ctx->io[0x0F] & ctx->io[0x80] & 0x1F))) ctx->stopped = 1;
     }
-    if (ctx->apu) gb_audio_step(ctx, cycles);
     if (ctx->ime_pending) { ctx->ime = 1; ctx->ime_pending = 0; }
 }
 
@@ -917,15 +1212,110 @@ void gb_handle_interrupts(GBContext* ctx) {
  * Execution
  * ========================================================================== */
 
-uint32_t gb_run_frame(GBContext* ctx) {
-    gb_reset_frame(ctx);
-    uint32_t start = ctx->cycles;
+/* ============================================================================
+ * Run-Ahead
+ *
+ * The real frame runs undrawn, then the machine is snapshotted and run
+ * ahead; the last frame ahead is the one shown, and the snapshot is
+ * restored so emulation continues from the real frame. Hidden frames skip
+ * rasterization and audio synthesis, which leaves mostly the CPU, PPU
+ * timing and the snapshot copy per extra frame.
+ * ========================================================================== */
+
+typedef struct {
+    uint32_t frames;   /* Frames emulated ahead of the real one */
+    uint8_t* state;    /* Snapshot of the real frame */
+    size_t state_size;
+} RunAhead;
+
+static uint32_t run_frame(GBContext* ctx);
+
+bool gb_set_run_ahead(GBContext* ctx, uint32_t frames) {
+    RunAhead* ahead = (RunAhead*)ctx->run_ahead;
+    if (frames == 0) {
+        if (ahead) {
+            free(ahead->state);
+            free(ahead);
+            ctx->run_ahead = NULL;
+        }
+        return true;
+    }
     
+    size_t size = gb_state_size(ctx);
+    uint8_t* state = (uint8_t*)malloc(size);
+    if (!state) return false;
+    if (!ahead) {
+        ahead = (RunAhead*)calloc(1, sizeof(RunAhead));
+        if (!ahead) {
+            free(state);
+            return false;
+        }
+        ctx->run_ahead = ahead;
+    }
+    free(ahead->state);
+    ahead->state = state;
+    ahead->state_size = size;
+    ahead->frames = frames;
+    
+    /* Every frame is rolled back: keep rendering and audio on this thread */
+    gb_set_deferred_rendering(ctx, false);
+    gb_set_audio_thread(ctx, false);
+    return true;
+}
+
+static uint32_t run_frame_ahead(GBContext* ctx, RunAhead* ahead) {
+    GBPPU* ppu = (GBPPU*)ctx->ppu;
+    void (*on_vblank)(GBContext*, const uint8_t*) = ctx->callbacks.on_vblank;
+    
+    /* Frameskip decides for the shown frame, once per real frame */
+    bool skip_shown = ppu && ppu->skip_next;
+    uint32_t skip_phase = ppu ? ppu->skip_phase : 0;
+    
+    ctx->callbacks.on_vblank = NULL;
+    gb_skip_next_frame(ctx);
+    uint32_t cycles = run_frame(ctx);
+    if (!gb_state_save(ctx, ahead->state, ahead->state_size)) {
+        ctx->callbacks.on_vblank = on_vblank;
+        return cycles;
+    }
+    
+    gb_audio_set_silent(ctx, true);
+    for (uint32_t i = 1; i <= ahead->frames; i++) {
+        if (i < ahead->frames) {
+            gb_skip_next_frame(ctx);
+        } else if (ppu) {
+            ppu->skip_next = skip_shown;
+            ppu->skip_phase = skip_phase;
+            ctx->callbacks.on_vblank = on_vblank;
+        }
+        run_frame(ctx);
+    }
+    ctx->callbacks.on_vblank = on_vblank;
+    gb_audio_set_silent(ctx, false);
+    
+    gb_state_rollback(ctx, ahead->state, ahead->state_size);
+    return cycles;
+}
+
+uint32_t gb_run_frame(GBContext* ctx) {
     static int fcount = 0;
     fcount++;
     if (fcount % 60 == 0) {
         fprintf(stderr, "[FRAME] Frame %d, Cycles: %u\n", fcount, ctx->cycles);
     }
+    
+    if (ctx->run_ahead) return run_frame_ahead(ctx, (RunAhead*)ctx->run_ahead);
+    return run_frame(ctx);
+}
+
+static uint32_t run_frame(GBContext* ctx) {
+    gb_reset_frame(ctx);
+    uint32_t start = ctx->cycles;
+    
+    /* Input is polled again on this frame's first JOYP read. A game waiting
+       on the joypad interrupt may never read it, so poll up front then. */
+    ctx->joypad_polled = false;
+    if (ctx->callbacks.get_joypad && (ctx->io[0x80] & 0x10)) joypad_state(ctx);
 
     while (!ctx->frame_done) {
         gb_handle_interrupts(ctx);
@@ -942,6 +1332,7 @@ uint32_t gb_run_frame(GBContext* ctx) {
         else gb_step(ctx);
         gb_sync(ctx);
     }
+    if (ctx->apu) gb_audio_end_frame(ctx);
     return ctx->cycles - start;
 }
 
@@ -973,6 +1364,54 @@ const uint32_t* gb_get_framebuffer(GBContext* ctx) {
     return NULL;
 }
 
+bool gb_frame_changed(GBContext* ctx) {
+    if (ctx->ppu) return ppu_frame_changed((GBPPU*)ctx->ppu);
+    return true;
+}
+
+void gb_set_video_buffer(GBContext* ctx, uint32_t* pixels, size_t pitch) {
+    if (ctx->ppu) ppu_set_output_buffer((GBPPU*)ctx->ppu, pixels, GB_PIXEL_ARGB8888, pitch);
+}
+
+void gb_set_video_scale(GBContext* ctx, int filter) {
+    if (ctx->ppu) ppu_set_output_scale((GBPPU*)ctx->ppu, (GBScaleFilter)filter);
+}
+
+void gb_set_audio_buffer(GBContext* ctx, void* samples, size_t frames) {
+    if (ctx->apu) gb_audio_set_buffer(ctx, samples, frames);
+}
+
+bool gb_set_audio_format(GBContext* ctx, uint32_t sample_rate, GBSampleFormat format, int channels) {
+    if (!ctx->apu) return false;
+    return gb_audio_set_format(ctx, sample_rate, format, channels);
+}
+
+void gb_set_audio_highpass(GBContext* ctx, bool enabled) {
+    if (ctx->apu) gb_audio_set_highpass(ctx, enabled);
+}
+
+bool gb_set_audio_thread(GBContext* ctx, bool enabled) {
+    if (!ctx->apu) return false;
+    return gb_audio_set_threaded(ctx, enabled);
+}
+
+void gb_set_frameskip(GBContext* ctx, uint32_t skip, uint32_t period) {
+    if (ctx->ppu) ppu_set_frameskip((GBPPU*)ctx->ppu, skip, period);
+}
+
+void gb_skip_next_frame(GBContext* ctx) {
+    if (ctx->ppu) ppu_skip_next_frame((GBPPU*)ctx->ppu);
+}
+
+void gb_set_headless(GBContext* ctx, bool headless) {
+    if (ctx->ppu) ppu_set_headless((GBPPU*)ctx->ppu, headless);
+}
+
+bool gb_set_deferred_rendering(GBContext* ctx, bool enabled) {
+    if (!ctx->ppu) return false;
+    return ppu_set_deferred((GBPPU*)ctx->ppu, ctx, enabled);
+}
+
 void gb_halt(GBContext* ctx) { ctx->halted = 1; }
 void gb_stop(GBContext* ctx) { ctx->stopped = 1; }
 bool gb_frame_complete(GBContext* ctx) { return ctx->frame_done != 0; }
@@ -0,0 +1,341 @@
+/**
+ * @file platform_headless.c
+ * @brief Headless platform backend: Y4M/RGB24 video and WAV/PCM audio streams
+ */
+
+#include "platform_headless.h"
+#include "ppu.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#endif
+
+/* ============================================================================
+ * Definitions
+ * ========================================================================== */
+
+/* Exact DMG frame rate as a Y4M fraction: 4194304 Hz / 70224 cycles */
+#define FRAME_RATE_NUM 4194304
+#define FRAME_RATE_DEN 70224
+
+#define DEFAULT_SAMPLE_RATE 44100
+#define STREAM_BUFFER_SIZE (1 << 20)
+
+#define CHROMA_WIDTH  (GB_SCREEN_WIDTH / 2)
+#define CHROMA_HEIGHT (GB_SCREEN_HEIGHT / 2)
+
+/* Y4M frame: "FRAME\n" followed by the Y, U and V planes */
+#define Y4M_FRAME_SIZE (GB_FRAMEBUFFER_SIZE + 2 * CHROMA_WIDTH * CHROMA_HEIGHT)
+#define RGB_FRAME_SIZE (GB_FRAMEBUFFER_SIZE * 3)
+
+/* ============================================================================
+ * State
+ * ========================================================================== */
+
+typedef struct {
+    FILE* file;
+    bool is_stdout;
+} OutputStream;
+
+static GBContext* g_ctx = NULL;
+
+static OutputStream g_video;
+static GBVideoOutFormat g_video_format;
+static uint8_t* g_frame = NULL;       /* Last encoded frame, rewritten while unchanged */
+static size_t g_frame_size = 0;
+static bool g_frame_valid = false;
+static uint32_t g_last_cycles = 0;    /* ctx->cycles at the last submit */
+static uint32_t g_pending = 0;        /* Emulated cycles not yet covered by a written frame */
+
+static OutputStream g_audio;
+static GBAudioOutFormat g_audio_format;
+static uint32_t g_audio_rate;
+static GBSampleFormat g_sample_format;
+static int g_channels;
+static uint64_t g_audio_bytes = 0;    /* WAV data chunk size so far */
+
+static bool g_atexit_registered = false;
+
+/* ============================================================================
+ * Streams
+ * ========================================================================== */
+
+static bool ends_with(const char* s, const char* suffix) {
+    size_t n = strlen(s), m = strlen(suffix);
+    if (n < m) return false;
+    for (size_t i = 0; i < m; i++) {
+        char c = s[n - m + i];
+        if (c >= 'A' && c <= 'Z') c = (char)(c - 'A' + 'a');
+        if (c != suffix[i]) return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Whether AUTO picks the container format: by extension, and always
+ *        for stdout, which is usually piped into an encoder
+ */
+static bool self_describing(const char* path, const char* extension) {
+    return strcmp(path, "-") == 0 || ends_with(path, extension);
+}
+
+/**
+ * @brief Open a path for binary writing; "-" is stdout
+ */
+static bool stream_open(OutputStream* s, const char* path) {
+    s->is_stdout = strcmp(path, "-") == 0;
+    if (s->is_stdout) {
+#ifdef _WIN32
+        _setmode(_fileno(stdout), _O_BINARY);
+#endif
+        s->file = stdout;
+    } else {
+        s->file = fopen(path, "wb");
+    }
+    if (!s->file) {
+        fprintf(stderr, "[HEADLESS] Cannot open %s for writing\n", path);
+        return false;
+    }
+    setvbuf(s->file, NULL, _IOFBF, STREAM_BUFFER_SIZE);
+    return true;
+}
+
+static void stream_close(OutputStream* s) {
+    if (!s->file) return;
+    if (s->is_stdout) {
+        fflush(s->file);
+    } else {
+        fclose(s->file);
+    }
+    s->file = NULL;
+}
+
+static void put_le16(uint8_t* p, uint16_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static void put_le32(uint8_t* p, uint32_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+/* ============================================================================
+ * Video
+ * ========================================================================== */
+
+/* BT.601 limited range, 8-bit fixed point */
+static uint8_t rgb_to_y(int r, int g, int b) {
+    return (uint8_t)(((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+}
+
+static uint8_t rgb_to_u(int r, int g, int b) {
+    return (uint8_t)(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+}
+
+static uint8_t rgb_to_v(int r, int g, int b) {
+    return (uint8_t)(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+}
+
+/**
+ * @brief ARGB8888 to planar 4:2:0, chroma averaged over each 2x2 block
+ */
+static void encode_y4m(uint8_t* out, const uint32_t* fb) {
+    uint8_t* y_plane = out;
+    uint8_t* u_plane = y_plane + GB_FRAMEBUFFER_SIZE;
+    uint8_t* v_plane = u_plane + CHROMA_WIDTH * CHROMA_HEIGHT;
+
+    for (int i = 0; i < GB_FRAMEBUFFER_SIZE; i++) {
+        uint32_t p = fb[i];
+        y_plane[i] = rgb_to_y((p >> 16) & 0xFF, (p >> 8) & 0xFF, p & 0xFF);
+    }
+
+    for (int cy = 0; cy < CHROMA_HEIGHT; cy++) {
+        const uint32_t* row0 = fb + (cy * 2) * GB_SCREEN_WIDTH;
+        const uint32_t* row1 = row0 + GB_SCREEN_WIDTH;
+        for (int cx = 0; cx < CHROMA_WIDTH; cx++) {
+            uint32_t p[4] = { row0[cx * 2], row0[cx * 2 + 1], row1[cx * 2], row1[cx * 2 + 1] };
+            int r = 0, g = 0, b = 0;
+            for (int k = 0; k < 4; k++) {
+                r += (p[k] >> 16) & 0xFF;
+                g += (p[k] >> 8) & 0xFF;
+                b += p[k] & 0xFF;
+            }
+            r = (r + 2) >> 2;
+            g = (g + 2) >> 2;
+            b = (b + 2) >> 2;
+            u_plane[cy * CHROMA_WIDTH + cx] = rgb_to_u(r, g, b);
+            v_plane[cy * CHROMA_WIDTH + cx] = rgb_to_v(r, g, b);
+        }
+    }
+}
+
+static void encode_rgb24(uint8_t* out, const uint32_t* fb) {
+    for (int i = 0; i < GB_FRAMEBUFFER_SIZE; i++) {
+        uint32_t p = fb[i];
+        out[i * 3 + 0] = (p >> 16) & 0xFF;  /* R */
+        out[i * 3 + 1] = (p >> 8) & 0xFF;   /* G */
+        out[i * 3 + 2] = p & 0xFF;          /* B */
+    }
+}
+
+void gb_headless_submit_frame(GBContext* ctx) {
+    if (!g_video.file) return;
+
+    /* gb_run_frame can overshoot a frame's worth of cycles, so write one
+       frame per 70224 hardware cycles actually emulated; this keeps the
+       video in step with the audio stream */
+    g_pending += (uint32_t)(ctx->cycles - g_last_cycles);
+    g_last_cycles = ctx->cycles;
+    if (g_pending < FRAME_RATE_DEN) return;
+
+    /* Unchanged frames (and frameskipped ones) repeat the last encoding so
+       the stream keeps a constant frame rate */
+    if (!g_frame_valid || gb_frame_changed(ctx)) {
+        const uint32_t* fb = gb_get_framebuffer(ctx);
+        if (!fb) return;
+        if (g_video_format == GB_VIDEO_OUT_Y4M) {
+            encode_y4m(g_frame, fb);
+        } else {
+            encode_rgb24(g_frame, fb);
+        }
+        g_frame_valid = true;
+    }
+
+    for (; g_pending >= FRAME_RATE_DEN; g_pending -= FRAME_RATE_DEN) {
+        if (g_video_format == GB_VIDEO_OUT_Y4M) {
+            fputs("FRAME\n", g_video.file);
+        }
+        fwrite(g_frame, 1, g_frame_size, g_video.file);
+    }
+}
+
+/* ============================================================================
+ * Audio
+ * ========================================================================== */
+
+/**
+ * @brief RIFF header; data sizes are 0xFFFFFFFF until patched (streaming)
+ */
+static void write_wav_header(uint32_t rate, GBSampleFormat format, int channels, uint32_t data_bytes) {
+    uint16_t bits = format == GB_SAMPLE_F32 ? 32 : 16;
+    uint16_t block_align = (uint16_t)(channels * bits / 8);
+    uint8_t h[44];
+
+    memcpy(h, "RIFF", 4);
+    put_le32(h + 4, data_bytes == 0xFFFFFFFFu ? data_bytes : data_bytes + 36);
+    memcpy(h + 8, "WAVEfmt ", 8);
+    put_le32(h + 16, 16);
+    put_le16(h + 20, format == GB_SAMPLE_F32 ? 3 : 1);  /* IEEE float / PCM */
+    put_le16(h + 22, (uint16_t)channels);
+    put_le32(h + 24, rate);
+    put_le32(h + 28, rate * block_align);
+    put_le16(h + 32, block_align);
+    put_le16(h + 34, bits);
+    memcpy(h + 36, "data", 4);
+    put_le32(h + 40, data_bytes);
+    fwrite(h, 1, sizeof(h), g_audio.file);
+}
+
+static void on_audio_block(GBContext* ctx, const void* samples, size_t frames) {
+    (void)ctx;
+    size_t bytes = frames * (size_t)g_channels * (g_sample_format == GB_SAMPLE_F32 ? 4 : 2);
+    fwrite(samples, 1, bytes, g_audio.file);
+    g_audio_bytes += bytes;
+}
+
+/* ============================================================================
+ * Backend
+ * ========================================================================== */
+
+static void headless_atexit(void) {
+    gb_headless_shutdown();
+}
+
+bool gb_headless_init(GBContext* ctx, const GBHeadlessConfig* config) {
+    g_ctx = ctx;
+
+    if (config->video_path) {
+        g_video_format = config->video_format;
+        if (g_video_format == GB_VIDEO_OUT_AUTO) {
+            g_video_format = self_describing(config->video_path, ".y4m") ? GB_VIDEO_OUT_Y4M : GB_VIDEO_OUT_RGB24;
+        }
+        g_frame_size = g_video_format == GB_VIDEO_OUT_Y4M ? Y4M_FRAME_SIZE : RGB_FRAME_SIZE;
+        g_frame = (uint8_t*)malloc(g_frame_size);
+        g_frame_valid = false;
+        g_last_cycles = ctx->cycles;
+        g_pending = 0;
+        if (!g_frame || !stream_open(&g_video, config->video_path)) {
+            gb_headless_shutdown();
+            return false;
+        }
+        if (g_video_format == GB_VIDEO_OUT_Y4M) {
+            fprintf(g_video.file, "YUV4MPEG2 W%d H%d F%d:%d Ip A1:1 C420jpeg\n",
+                    GB_SCREEN_WIDTH, GB_SCREEN_HEIGHT, FRAME_RATE_NUM, FRAME_RATE_DEN);
+        }
+    }
+
+    if (config->audio_path) {
+        g_audio_format = config->audio_format;
+        if (g_audio_format == GB_AUDIO_OUT_AUTO) {
+            g_audio_format = self_describing(config->audio_path, ".wav") ? GB_AUDIO_OUT_WAV : GB_AUDIO_OUT_RAW;
+        }
+        g_audio_rate = config->sample_rate ? config->sample_rate : DEFAULT_SAMPLE_RATE;
+        g_sample_format = config->sample_format;
+        g_channels = config->channels ? config->channels : 2;
+        g_audio_bytes = 0;
+
+        if (!stream_open(&g_audio, config->audio_path) ||
+            !gb_set_audio_format(ctx, g_audio_rate, g_sample_format, g_channels)) {
+            fprintf(stderr, "[HEADLESS] Audio output setup failed\n");
+            gb_headless_shutdown();
+            return false;
+        }
+        if (g_audio_format == GB_AUDIO_OUT_WAV) {
+            write_wav_header(g_audio_rate, g_sample_format, g_channels, 0xFFFFFFFFu);
+        }
+
+        GBPlatformCallbacks callbacks = ctx->callbacks;
+        callbacks.on_audio_block = on_audio_block;
+        callbacks.on_audio_sample = NULL;
+        gb_set_platform_callbacks(ctx, &callbacks);
+    }
+
+    /* --limit ends the process from inside gb_step; still finalize the files */
+    if (!g_atexit_registered) {
+        atexit(headless_atexit);
+        g_atexit_registered = true;
+    }
+    return true;
+}
+
+void gb_headless_shutdown(void) {
+    if (g_audio.file) {
+        /* Drain the audio worker so every block has been written */
+        if (g_ctx) gb_set_audio_thread(g_ctx, false);
+
+        /* Pipes, and files past the 4 GiB RIFF limit, keep the streaming sizes */
+        if (g_audio_format == GB_AUDIO_OUT_WAV && !g_audio.is_stdout &&
+            g_audio_bytes < 0xFFFFFFFFu - 36 && fseek(g_audio.file, 0, SEEK_SET) == 0) {
+            write_wav_header(g_audio_rate, g_sample_format, g_channels, (uint32_t)g_audio_bytes);
+        }
+        stream_close(&g_audio);
+
+        if (g_ctx) {
+            GBPlatformCallbacks callbacks = g_ctx->callbacks;
+            callbacks.on_audio_block = NULL;
+            gb_set_platform_callbacks(g_ctx, &callbacks);
+        }
+    }
+    stream_close(&g_video);
+    free(g_frame);
+    g_frame = NULL;
+    g_ctx = NULL;
+}
@@ -19,8 +19,10 @@ static SDL_Window* g_window = NULL;
 static SDL_Renderer* g_renderer = NULL;
 static SDL_Texture* g_texture = NULL;
 static int g_scale = 3;
-static uint32_t g_last_frame_time = 0;
 static SDL_AudioDeviceID g_audio_device = 0;
+static GBContext* g_ctx = NULL;
+static GBPacingMode g_pacing = GB_PACING_AUDIO;
+static bool g_present_thread = false;
 
 /* Joypad state - exported for gbrt.c to access */
 /* Joypad state - exported for gbrt.c to access */
@@ -33,6 +35,7 @@ uint8_t g_joypad_dpad = 0xFF;     /* Active low: Down, Up, Left, Right */
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <stdatomic.h>
 
 #define MAX_SCRIPT_ENTRIES 100
 typedef struct {
@@ -47,7 +50,11 @@ static int g_script_count = 0;
 static int g_script_idx = 0;
 
 #define MAX_DUMP_FRAMES 100
-static uint32_t g_dump_frames[MAX_DUMP_FRAMES];
+typedef struct {
+    uint32_t first;
+    uint32_t last;
+} DumpRange;
+static DumpRange g_dump_frames[MAX_DUMP_FRAMES];
 static int g_dump_count = 0;
 static char g_screenshot_prefix[64] = "screenshot";
 
@@ -97,32 +104,40 @@ void gb_platform_set_dump_frames(const char* frames) {
     char* token = strtok(copy, ",");
     g_dump_count = 0;
     while (token && g_dump_count < MAX_DUMP_FRAMES) {
-        g_dump_frames[g_dump_count++] = (uint32_t)strtoul(token, NULL, 10);
+        /* "N", "N-M" or "all" */
+        DumpRange* range = &g_dump_frames[g_dump_count++];
+        if (strcmp(token, "all") == 0) {
+            range->first = 1;
+            range->last = UINT32_MAX;
+        } else {
+            char* end;
+            range->first = (uint32_t)strtoul(token, &end, 10);
+            range->last = (*end == '-') ? (uint32_t)strtoul(end + 1, NULL, 10) : range->first;
+        }
         token = strtok(NULL, ",");
     }
     free(copy);
 }
 
+static bool should_dump(uint32_t frame) {
+    for (int i = 0; i < g_dump_count; i++) {
+        if (frame >= g_dump_frames[i].first && frame <= g_dump_frames[i].last) return true;
+    }
+    return false;
+}
+
 void gb_platform_set_screenshot_prefix(const char* prefix) {
     if (prefix) snprintf(g_screenshot_prefix, sizeof(g_screenshot_prefix), "%s", prefix);
 }
 
-static void save_ppm(const char* filename, const uint32_t* fb, int width, int height, int frame_count) {
-    // Calculate simple hash
-    uint32_t hash = 0;
-    for (int k = 0; k < width * height; k++) {
-        hash = (hash * 33) ^ fb[k];
-    }
-    printf("[AUTO] Frame %d hash: %08X\n", frame_count, hash);
-
+static bool save_ppm(const char* filename, const uint32_t* fb, int width, int height) {
     FILE* f = fopen(filename, "wb");
-    if (!f) return;
+    if (!f) return false;
     
     fprintf(f, "P6\n%d %d\n255\n", width, height);
     
     // Convert ARGB to RGB
-    int num_pixels = width * height;
-    uint8_t* row = malloc(width * 3);
+    uint8_t row[GB_SCREEN_WIDTH * 3];
     for (int y = 0; y < height; y++) {
         for (int x = 0; x < width; x++) {
             uint32_t p = fb[y * width + x];
@@ -133,19 +148,373 @@ static void save_ppm(const char* filename, const uint32_t* fb, int width, int he
         fwrite(row, 1, width * 3, f);
     }
     
-    free(row);
     fclose(f);
-    printf("[AUTO] Saved screenshot: %s\n", filename);
+    return true;
+}
+
+/* ============================================================================
+ * PNG Writer
+ * ========================================================================== */
+
+/* Frames rarely use more than a handful of colors, so they are written as
+   palette PNGs packed to 1-4 bits per pixel. That alone makes a DMG frame
+   ~12x smaller than PPM; the zlib stream uses stored blocks, so no deflate
+   library is needed and writing stays memcpy-fast. */
+#define PNG_MAX_RAW ((1 + GB_SCREEN_WIDTH * 3) * GB_SCREEN_HEIGHT)
+
+static uint32_t g_crc_table[256];
+
+static uint32_t png_crc(uint32_t crc, const uint8_t* data, size_t len) {
+    if (!g_crc_table[1]) {
+        for (uint32_t n = 0; n < 256; n++) {
+            uint32_t c = n;
+            for (int k = 0; k < 8; k++) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            g_crc_table[n] = c;
+        }
+    }
+    for (size_t i = 0; i < len; i++) {
+        crc = g_crc_table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return crc;
+}
+
+static void put_be32(uint8_t* p, uint32_t v) {
+    p[0] = (uint8_t)(v >> 24);
+    p[1] = (uint8_t)(v >> 16);
+    p[2] = (uint8_t)(v >> 8);
+    p[3] = (uint8_t)v;
+}
+
+static void png_chunk(FILE* f, const char* type, const uint8_t* data, uint32_t len) {
+    uint8_t head[8];
+    uint8_t tail[4];
+    put_be32(head, len);
+    memcpy(head + 4, type, 4);
+    uint32_t crc = png_crc(0xFFFFFFFFu, head + 4, 4);
+    crc = png_crc(crc, data, len);
+    put_be32(tail, crc ^ 0xFFFFFFFFu);
+    fwrite(head, 1, 8, f);
+    fwrite(data, 1, len, f);
+    fwrite(tail, 1, 4, f);
+}
+
+static bool save_png(const char* filename, const uint32_t* fb, int width, int height) {
+    /* Palette (or truecolor when a frame has more than 256 colors) */
+    uint8_t plte[256 * 3];
+    uint32_t palette[256];
+    int colors = 0;
+    static uint8_t index[GB_FRAMEBUFFER_SIZE];
+    uint32_t last = 0;
+    int last_index = -1;
+    for (int i = 0; i < width * height && colors <= 256; i++) {
+        uint32_t p = fb[i] & 0xFFFFFF;
+        if (p != last || last_index < 0) {
+            last_index = -1;
+            for (int c = 0; c < colors; c++) {
+                if (palette[c] == p) { last_index = c; break; }
+            }
+            if (last_index < 0) {
+                if (colors == 256) { colors++; break; }
+                palette[colors] = p;
+                last_index = colors++;
+            }
+            last = p;
+        }
+        index[i] = (uint8_t)last_index;
+    }
+    bool truecolor = colors > 256;
+    int bits = truecolor ? 8 : colors <= 2 ? 1 : colors <= 4 ? 2 : colors <= 16 ? 4 : 8;
+    
+    /* Filtered scanlines (filter 0), then the zlib stream around them */
+    static uint8_t raw[PNG_MAX_RAW];
+    size_t stride = truecolor ? (size_t)width * 3 : ((size_t)width * bits + 7) / 8;
+    size_t raw_len = (1 + stride) * (size_t)height;
+    for (int y = 0; y < height; y++) {
+        uint8_t* out = raw + (size_t)y * (1 + stride);
+        *out++ = 0;
+        if (truecolor) {
+            for (int x = 0; x < width; x++) {
+                uint32_t p = fb[y * width + x];
+                out[x*3+0] = (p >> 16) & 0xFF;
+                out[x*3+1] = (p >> 8) & 0xFF;
+                out[x*3+2] = p & 0xFF;
+            }
+        } else {
+            memset(out, 0, stride);
+            for (int x = 0; x < width; x++) {
+                int shift = 8 - bits - (x * bits) % 8;
+                out[(x * bits) / 8] |= (uint8_t)(index[y * width + x] << shift);
+            }
+        }
+    }
+    
+    size_t blocks = (raw_len + 65534) / 65535;
+    size_t idat_len = 2 + raw_len + blocks * 5 + 4;
+    uint8_t* idat = malloc(idat_len);
+    if (!idat) return false;
+    uint8_t* z = idat;
+    *z++ = 0x78;  /* CMF: deflate, 32K window */
+    *z++ = 0x01;  /* FLG: no dictionary, check bits */
+    uint32_t a = 1, b = 0;
+    for (size_t pos = 0; pos < raw_len;) {
+        size_t len = raw_len - pos < 65535 ? raw_len - pos : 65535;
+        *z++ = (pos + len == raw_len) ? 1 : 0;  /* BFINAL, BTYPE = stored */
+        z[0] = (uint8_t)len;
+        z[1] = (uint8_t)(len >> 8);
+        z[2] = (uint8_t)~len;
+        z[3] = (uint8_t)(~len >> 8);
+        z += 4;
+        memcpy(z, raw + pos, len);
+        for (size_t i = 0; i < len; i++) {
+            a = (a + z[i]) % 65521;
+            b = (b + a) % 65521;
+        }
+        z += len;
+        pos += len;
+    }
+    put_be32(z, (b << 16) | a);
+    
+    FILE* f = fopen(filename, "wb");
+    if (!f) {
+        free(idat);
+        return false;
+    }
+    static const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    uint8_t ihdr[13];
+    put_be32(ihdr, (uint32_t)width);
+    put_be32(ihdr + 4, (uint32_t)height);
+    ihdr[8] = (uint8_t)bits;
+    ihdr[9] = truecolor ? 2 : 3;  /* Truecolor / palette */
+    ihdr[10] = ihdr[11] = ihdr[12] = 0;
+    fwrite(signature, 1, sizeof(signature), f);
+    png_chunk(f, "IHDR", ihdr, sizeof(ihdr));
+    if (!truecolor) {
+        for (int c = 0; c < colors; c++) {
+            plte[c*3+0] = (palette[c] >> 16) & 0xFF;
+            plte[c*3+1] = (palette[c] >> 8) & 0xFF;
+            plte[c*3+2] = palette[c] & 0xFF;
+        }
+        png_chunk(f, "PLTE", plte, (uint32_t)colors * 3);
+    }
+    png_chunk(f, "IDAT", idat, (uint32_t)idat_len);
+    png_chunk(f, "IEND", NULL, 0);
+    free(idat);
+    fclose(f);
+    return true;
+}
+
+/* ============================================================================
+ * Capture Writer
+ * ========================================================================== */
+
+/* Screenshots are hashed, encoded and written on a background thread. The
+   emulation thread only copies the frame into a bounded queue; when the
+   queue is full it either waits (every frame is kept) or drops the frame. */
+#define CAPTURE_QUEUE_SIZE 16
+
+typedef struct {
+    uint32_t pixels[GB_FRAMEBUFFER_SIZE];
+    int frame;
+} CaptureSlot;
+
+static CaptureSlot* g_capture_queue = NULL;
+static int g_capture_head = 0;     /* Next slot the writer takes */
+static int g_capture_count = 0;    /* Slots queued */
+static SDL_mutex* g_capture_lock = NULL;
+static SDL_cond* g_capture_ready = NULL;  /* Queue became non-empty (or quit) */
+static SDL_cond* g_capture_space = NULL;  /* A slot was freed */
+static SDL_Thread* g_capture_thread = NULL;
+static bool g_capture_quit = false;
+static bool g_capture_started = false;
+static uint32_t g_capture_dropped = 0;
+static GBCaptureFormat g_capture_format = GB_CAPTURE_PPM;
+static GBCapturePolicy g_capture_policy = GB_CAPTURE_BLOCK;
+
+/**
+ * @brief Hash, encode and write one captured frame
+ */
+static void capture_write(const uint32_t* fb, int frame_count) {
+    // Calculate simple hash
+    uint32_t hash = 0;
+    for (int k = 0; k < GB_FRAMEBUFFER_SIZE; k++) {
+        hash = (hash * 33) ^ fb[k];
+    }
+    printf("[AUTO] Frame %d hash: %08X\n", frame_count, hash);
+    
+    char filename[128];
+    bool png = g_capture_format == GB_CAPTURE_PNG;
+    snprintf(filename, sizeof(filename), "%s_%05d.%s", g_screenshot_prefix, frame_count, png ? "png" : "ppm");
+    bool ok = png ? save_png(filename, fb, GB_SCREEN_WIDTH, GB_SCREEN_HEIGHT)
+                  : save_ppm(filename, fb, GB_SCREEN_WIDTH, GB_SCREEN_HEIGHT);
+    if (ok) printf("[AUTO] Saved screenshot: %s\n", filename);
+}
+
+static int capture_main(void* arg) {
+    (void)arg;
+    SDL_LockMutex(g_capture_lock);
+    for (;;) {
+        while (g_capture_count == 0 && !g_capture_quit) {
+            SDL_CondWait(g_capture_ready, g_capture_lock);
+        }
+        if (g_capture_count == 0) break;  /* Quit with the queue drained */
+        
+        CaptureSlot* slot = &g_capture_queue[g_capture_head];
+        SDL_UnlockMutex(g_capture_lock);
+        capture_write(slot->pixels, slot->frame);
+        SDL_LockMutex(g_capture_lock);
+        
+        g_capture_head = (g_capture_head + 1) % CAPTURE_QUEUE_SIZE;
+        g_capture_count--;
+        SDL_CondSignal(g_capture_space);
+    }
+    SDL_UnlockMutex(g_capture_lock);
+    fflush(stdout);
+    return 0;
+}
+
+static bool capture_start(void) {
+    g_capture_started = true;
+    g_capture_queue = malloc(sizeof(CaptureSlot) * CAPTURE_QUEUE_SIZE);
+    g_capture_lock = SDL_CreateMutex();
+    g_capture_ready = SDL_CreateCond();
+    g_capture_space = SDL_CreateCond();
+    if (g_capture_queue && g_capture_lock && g_capture_ready && g_capture_space) {
+        g_capture_thread = SDL_CreateThread(capture_main, "gb-capture", NULL);
+    }
+    if (!g_capture_thread) {
+        fprintf(stderr, "[SDL] Capture thread unavailable, writing screenshots inline\n");
+    }
+    return g_capture_thread != NULL;
+}
+
+/**
+ * @brief Queue a frame for the writer (emulation thread)
+ */
+static void capture_submit(const uint32_t* fb, int frame_count) {
+    if (!g_capture_started) capture_start();
+    if (!g_capture_thread) {
+        capture_write(fb, frame_count);
+        return;
+    }
+    
+    SDL_LockMutex(g_capture_lock);
+    if (g_capture_count == CAPTURE_QUEUE_SIZE && g_capture_policy == GB_CAPTURE_DROP) {
+        g_capture_dropped++;
+        SDL_UnlockMutex(g_capture_lock);
+        return;
+    }
+    while (g_capture_count == CAPTURE_QUEUE_SIZE) {
+        SDL_CondWait(g_capture_space, g_capture_lock);
+    }
+    /* Only the emulation thread fills slots past the writer's range */
+    CaptureSlot* slot = &g_capture_queue[(g_capture_head + g_capture_count) % CAPTURE_QUEUE_SIZE];
+    SDL_UnlockMutex(g_capture_lock);
+    
+    memcpy(slot->pixels, fb, sizeof(slot->pixels));
+    slot->frame = frame_count;
+    
+    SDL_LockMutex(g_capture_lock);
+    g_capture_count++;
+    SDL_CondSignal(g_capture_ready);
+    SDL_UnlockMutex(g_capture_lock);
+}
+
+/**
+ * @brief Write out everything still queued and stop the writer
+ */
+static void capture_stop(void) {
+    if (g_capture_thread) {
+        SDL_LockMutex(g_capture_lock);
+        g_capture_quit = true;
+        SDL_CondSignal(g_capture_ready);
+        SDL_UnlockMutex(g_capture_lock);
+        SDL_WaitThread(g_capture_thread, NULL);
+        g_capture_thread = NULL;
+        if (g_capture_dropped) {
+            fprintf(stderr, "[SDL] Capture: %u frames dropped (queue full)\n", (unsigned)g_capture_dropped);
+        }
+    }
+    if (g_capture_space) SDL_DestroyCond(g_capture_space);
+    if (g_capture_ready) SDL_DestroyCond(g_capture_ready);
+    if (g_capture_lock) SDL_DestroyMutex(g_capture_lock);
+    free(g_capture_queue);
+    g_capture_space = g_capture_ready = NULL;
+    g_capture_lock = NULL;
+    g_capture_queue = NULL;
+}
+
+void gb_platform_set_capture(GBCaptureFormat format, GBCapturePolicy policy) {
+    g_capture_format = format;
+    g_capture_policy = policy;
 }
 
 
 static int g_frame_count = 0;
 
 /* ============================================================================
- * Platform Functions
+ * Presentation
  * ========================================================================== */
 
-void gb_platform_shutdown(void) {
+/* Finished frames reach the renderer through three ARGB slots. The PPU
+   converts into the back slot, a finished frame is swapped into the shared
+   slot, and the presenter swaps it out into its front slot, so neither side
+   ever waits for the other. */
+#define PRESENT_SLOTS 3
+#define PRESENT_FRESH 0x4u  /* Shared slot holds a frame not yet presented */
+
+static uint32_t g_frame_slots[PRESENT_SLOTS][GB_FRAMEBUFFER_SIZE];
+static atomic_uint g_shared_slot = 1;
+static unsigned g_back_slot = 0;   /* Emulation thread only */
+static unsigned g_front_slot = 2;  /* Presenter thread only */
+
+static SDL_Thread* g_presenter = NULL;
+static SDL_sem* g_frame_sem = NULL;    /* Posted once per emulated frame */
+static SDL_sem* g_present_sem = NULL;  /* Posted once per present (vsync pacing) */
+static SDL_sem* g_presenter_ready = NULL;
+static atomic_bool g_presenter_quit;
+static bool g_presenter_ok = false;
+
+/**
+ * @brief Create the renderer and streaming texture on the calling thread
+ */
+static bool create_renderer(void) {
+    fprintf(stderr, "[SDL] Creating renderer...\n");
+    /* Present waits for the display only when the display paces emulation */
+    Uint32 renderer_flags = SDL_RENDERER_ACCELERATED;
+    if (g_pacing == GB_PACING_VSYNC) renderer_flags |= SDL_RENDERER_PRESENTVSYNC;
+    g_renderer = SDL_CreateRenderer(g_window, -1, renderer_flags);
+        
+    if (!g_renderer) {
+        fprintf(stderr, "[SDL] Hardware renderer failed (flags=0x%x), trying software fallback...\n", 
+                renderer_flags);
+        g_renderer = SDL_CreateRenderer(g_window, -1, SDL_RENDERER_SOFTWARE);
+    }
+        
+    if (!g_renderer) {
+        fprintf(stderr, "[SDL] SDL_CreateRenderer failed: %s\n", SDL_GetError());
+        return false;
+    }
+    
+    SDL_SetHint(SDL_HINT_RENDER_SCALE_QUALITY, "nearest");
+    
+    g_texture = SDL_CreateTexture(
+        g_renderer,
+        SDL_PIXELFORMAT_ARGB8888,
+        SDL_TEXTUREACCESS_STREAMING,
+        GB_SCREEN_WIDTH,
+        GB_SCREEN_HEIGHT
+    );
+    
+    if (!g_texture) {
+        fprintf(stderr, "[SDL] SDL_CreateTexture failed: %s\n", SDL_GetError());
+        SDL_DestroyRenderer(g_renderer);
+        g_renderer = NULL;
+        return false;
+    }
+    return true;
+}
+
+static void destroy_renderer(void) {
     if (g_texture) {
         SDL_DestroyTexture(g_texture);
         g_texture = NULL;
@@ -154,6 +523,127 @@ void gb_platform_shutdown(void) {
         SDL_DestroyRenderer(g_renderer);
         g_renderer = NULL;
     }
+}
+
+/**
+ * @brief Write a frame into the streaming texture (renderer thread only)
+ */
+static void upload_frame(const uint32_t* pixels) {
+    void* dst;
+    int pitch;
+    
+    if (SDL_LockTexture(g_texture, NULL, &dst, &pitch) != 0) {
+        SDL_UpdateTexture(g_texture, NULL, pixels, GB_SCREEN_WIDTH * sizeof(uint32_t));
+        return;
+    }
+    if (pitch == GB_SCREEN_WIDTH * (int)sizeof(uint32_t)) {
+        memcpy(dst, pixels, GB_FRAMEBUFFER_SIZE * sizeof(uint32_t));
+    } else {
+        for (int y = 0; y < GB_SCREEN_HEIGHT; y++) {
+            memcpy((uint8_t*)dst + (size_t)y * (size_t)pitch, pixels + y * GB_SCREEN_WIDTH,
+                   GB_SCREEN_WIDTH * sizeof(uint32_t));
+        }
+    }
+    SDL_UnlockTexture(g_texture);
+}
+
+static void present(void) {
+    SDL_RenderClear(g_renderer);
+    SDL_RenderCopy(g_renderer, g_texture, NULL, NULL);
+    SDL_RenderPresent(g_renderer);
+}
+
+/**
+ * @brief Emulation side: hand the back slot over and start converting into another
+ */
+static void publish_frame(const uint32_t* framebuffer) {
+    if (framebuffer != g_frame_slots[g_back_slot]) {
+        /* No context registered (or a padded buffer): fall back to a copy */
+        memcpy(g_frame_slots[g_back_slot], framebuffer, sizeof(g_frame_slots[0]));
+    }
+    unsigned slot = atomic_exchange_explicit(&g_shared_slot, g_back_slot | PRESENT_FRESH,
+                                             memory_order_acq_rel);
+    g_back_slot = slot & ~PRESENT_FRESH;
+    if (g_ctx) gb_set_video_buffer(g_ctx, g_frame_slots[g_back_slot], 0);
+}
+
+static int presenter_main(void* arg) {
+    (void)arg;
+    g_presenter_ok = create_renderer();
+    SDL_SemPost(g_presenter_ready);
+    if (!g_presenter_ok) return 1;
+    
+    for (;;) {
+        SDL_SemWait(g_frame_sem);
+        if (atomic_load(&g_presenter_quit)) break;
+        /* Fell behind (driver stall): catch up with a single present */
+        while (SDL_SemTryWait(g_frame_sem) == 0) {}
+        
+        if (atomic_load_explicit(&g_shared_slot, memory_order_relaxed) & PRESENT_FRESH) {
+            unsigned slot = atomic_exchange_explicit(&g_shared_slot, g_front_slot,
+                                                     memory_order_acq_rel);
+            g_front_slot = slot & ~PRESENT_FRESH;
+            upload_frame(g_frame_slots[g_front_slot]);
+        }
+        present();
+        if (g_pacing == GB_PACING_VSYNC) SDL_SemPost(g_present_sem);
+    }
+    
+    destroy_renderer();
+    return 0;
+}
+
+/**
+ * @brief Start the presenter thread; it creates and owns the renderer
+ */
+static bool presenter_start(void) {
+    g_frame_sem = SDL_CreateSemaphore(0);
+    g_present_sem = SDL_CreateSemaphore(0);
+    g_presenter_ready = SDL_CreateSemaphore(0);
+    atomic_store(&g_presenter_quit, false);
+    
+    if (g_frame_sem && g_present_sem && g_presenter_ready) {
+        g_presenter = SDL_CreateThread(presenter_main, "gb-present", NULL);
+    }
+    if (g_presenter) {
+        SDL_SemWait(g_presenter_ready);
+        if (g_presenter_ok) return true;
+        SDL_WaitThread(g_presenter, NULL);
+        g_presenter = NULL;
+    } else {
+        fprintf(stderr, "[SDL] Failed to start presenter thread: %s\n", SDL_GetError());
+    }
+    return false;
+}
+
+static void presenter_stop(void) {
+    if (g_presenter) {
+        atomic_store(&g_presenter_quit, true);
+        SDL_SemPost(g_frame_sem);
+        SDL_WaitThread(g_presenter, NULL);
+        g_presenter = NULL;
+    }
+    if (g_frame_sem) SDL_DestroySemaphore(g_frame_sem);
+    if (g_present_sem) SDL_DestroySemaphore(g_present_sem);
+    if (g_presenter_ready) SDL_DestroySemaphore(g_presenter_ready);
+    g_frame_sem = g_present_sem = g_presenter_ready = NULL;
+}
+
+void gb_platform_set_present_thread(bool enabled) {
+    g_present_thread = enabled;
+}
+
+/* ============================================================================
+ * Platform Functions
+ * ========================================================================== */
+
+void gb_platform_shutdown(void) {
+    capture_stop();
+    if (g_present_thread) {
+        presenter_stop();  /* The presenter tears its renderer down itself */
+    } else {
+        destroy_renderer();
+    }
     if (g_window) {
         SDL_DestroyWindow(g_window);
         g_window = NULL;
@@ -161,6 +651,13 @@ void gb_platform_shutdown(void) {
     if (g_audio_device) {
         SDL_CloseAudioDevice(g_audio_device);
         g_audio_device = 0;
+        
+        uint32_t underruns, overruns;
+        gb_platform_get_audio_stats(&underruns, &overruns);
+        if (underruns || overruns) {
+            fprintf(stderr, "[SDL] Audio: %u frames underrun, %u frames dropped\n",
+                    (unsigned)underruns, (unsigned)overruns);
+        }
     }
     SDL_Quit();
 }
@@ -170,39 +667,108 @@ void gb_platform_shutdown(void) {
  * ========================================================================== */
 
 #define AUDIO_SAMPLE_RATE 44100
-#define AUDIO_BUFFER_SIZE 4096 /* Samples (stereo frames) */
+#define AUDIO_RING_FRAMES 4096 /* Stereo frames, power of two */
+#define AUDIO_RING_MASK (AUDIO_RING_FRAMES - 1)
 
+/**
+ * @brief Single-producer/single-consumer ring of stereo frames
+ *
+ * The producer is whichever thread delivers audio blocks (emulation or the
+ * audio worker); the consumer is the SDL audio callback. Positions run
+ * freely and are masked on access. Each side writes only its own position
+ * and publishes it with release ordering after copying the frames.
+ */
+typedef struct {
+    int16_t frames[AUDIO_RING_FRAMES * 2];
+    _Atomic uint32_t write_pos;
+    _Atomic uint32_t read_pos;
+    _Atomic uint32_t underruns;   /* Frames the callback had to fill with silence */
+    _Atomic uint32_t overruns;    /* Frames dropped because the ring was full */
+} AudioRing;
 
-static int16_t g_audio_buffer[AUDIO_BUFFER_SIZE * 2]; /* *2 for stereo */
-static int g_audio_write_pos = 0;
-static int g_audio_read_pos = 0;
+static AudioRing g_audio_ring;
+static int g_audio_rate = AUDIO_SAMPLE_RATE;  /* Rate the device actually runs at */
+
+/* Auto frameskip: skip drawing while less than ~one frame of audio is
+   queued, but never more than a few frames in a row */
+#define AUTO_FRAMESKIP_LOW_WATER (g_audio_rate / 60)
+#define AUTO_FRAMESKIP_MAX 4
+static bool g_auto_frameskip = false;
+static int g_auto_skipped = 0;
+
+/**
+ * @brief Frames currently queued (safe from either side)
+ */
+static uint32_t audio_ring_fill(AudioRing* ring) {
+    uint32_t read = atomic_load_explicit(&ring->read_pos, memory_order_acquire);
+    uint32_t write = atomic_load_explicit(&ring->write_pos, memory_order_acquire);
+    return write - read;
+}
+
+/**
+ * @brief Producer: append up to count frames, dropping what doesn't fit
+ */
+static size_t audio_ring_push(AudioRing* ring, const int16_t* frames, size_t count) {
+    uint32_t write = atomic_load_explicit(&ring->write_pos, memory_order_relaxed);
+    uint32_t read = atomic_load_explicit(&ring->read_pos, memory_order_acquire);
+    size_t space = AUDIO_RING_FRAMES - (write - read);
+    
+    if (count > space) {
+        atomic_fetch_add_explicit(&ring->overruns, (uint32_t)(count - space), memory_order_relaxed);
+        count = space;
+    }
+    
+    size_t start = write & AUDIO_RING_MASK;
+    size_t first = AUDIO_RING_FRAMES - start;
+    if (first > count) first = count;
+    memcpy(&ring->frames[start * 2], frames, first * 2 * sizeof(int16_t));
+    memcpy(&ring->frames[0], frames + first * 2, (count - first) * 2 * sizeof(int16_t));
+    
+    atomic_store_explicit(&ring->write_pos, write + (uint32_t)count, memory_order_release);
+    return count;
+}
+
+/**
+ * @brief Consumer: take up to count frames, returning how many were available
+ */
+static size_t audio_ring_pop(AudioRing* ring, int16_t* frames, size_t count) {
+    uint32_t read = atomic_load_explicit(&ring->read_pos, memory_order_relaxed);
+    uint32_t write = atomic_load_explicit(&ring->write_pos, memory_order_acquire);
+    size_t available = write - read;
+    if (count > available) count = available;
+    
+    size_t start = read & AUDIO_RING_MASK;
+    size_t first = AUDIO_RING_FRAMES - start;
+    if (first > count) first = count;
+    memcpy(frames, &ring->frames[start * 2], first * 2 * sizeof(int16_t));
+    memcpy(frames + first * 2, &ring->frames[0], (count - first) * 2 * sizeof(int16_t));
+    
+    atomic_store_explicit(&ring->read_pos, read + (uint32_t)count, memory_order_release);
+    return count;
+}
 
 static void sdl_audio_callback(void* userdata, Uint8* stream, int len) {
     (void)userdata;
     int16_t* output = (int16_t*)stream;
-    int samples_needed = len / sizeof(int16_t) / 2; /* Stereo frames */
+    size_t frames_needed = (size_t)len / sizeof(int16_t) / 2; /* Stereo frames */
     
-    for (int i = 0; i < samples_needed; i++) {
-        if (g_audio_read_pos != g_audio_write_pos) {
-            output[i*2] = g_audio_buffer[g_audio_read_pos*2];
-            output[i*2+1] = g_audio_buffer[g_audio_read_pos*2+1];
-            g_audio_read_pos = (g_audio_read_pos + 1) % AUDIO_BUFFER_SIZE;
-        } else {
-            /* Buffer underrun - silence */
-            output[i*2] = 0;
-            output[i*2+1] = 0;
-        }
+    size_t got = audio_ring_pop(&g_audio_ring, output, frames_needed);
+    if (got < frames_needed) {
+        /* Buffer underrun - silence */
+        memset(output + got * 2, 0, (frames_needed - got) * 2 * sizeof(int16_t));
+        atomic_fetch_add_explicit(&g_audio_ring.underruns, (uint32_t)(frames_needed - got),
+                                  memory_order_relaxed);
     }
 }
 
-static void on_audio_sample(GBContext* ctx, int16_t left, int16_t right) {
+static void on_audio_block(GBContext* ctx, const void* block, size_t frames) {
     (void)ctx;
-    int next_pos = (g_audio_write_pos + 1) % AUDIO_BUFFER_SIZE;
-    if (next_pos != g_audio_read_pos) {
-        g_audio_buffer[g_audio_write_pos*2] = left;
-        g_audio_buffer[g_audio_write_pos*2+1] = right;
-        g_audio_write_pos = next_pos;
-    }
+    audio_ring_push(&g_audio_ring, (const int16_t*)block, frames);
+}
+
+void gb_platform_get_audio_stats(uint32_t* underruns, uint32_t* overruns) {
+    if (underruns) *underruns = atomic_load_explicit(&g_audio_ring.underruns, memory_order_relaxed);
+    if (overruns) *overruns = atomic_load_explicit(&g_audio_ring.overruns, memory_order_relaxed);
 }
 
 bool gb_platform_init(int scale) {
@@ -223,14 +789,16 @@ bool gb_platform_init(int scale) {
     want.freq = AUDIO_SAMPLE_RATE;
     want.format = AUDIO_S16SYS;
     want.channels = 2;
-    want.samples = 1024;
+    want.samples = 512;  /* The ring is race-free now, so keep device latency low */
     want.callback = sdl_audio_callback;
     want.userdata = NULL;
     
-    g_audio_device = SDL_OpenAudioDevice(NULL, 0, &want, &have, 0);
+    /* The APU synthesizes at any rate, so take whatever the device prefers */
+    g_audio_device = SDL_OpenAudioDevice(NULL, 0, &want, &have, SDL_AUDIO_ALLOW_FREQUENCY_CHANGE);
     if (g_audio_device == 0) {
         fprintf(stderr, "[SDL] Failed to open audio: %s\n", SDL_GetError());
     } else {
+        g_audio_rate = have.freq;
         fprintf(stderr, "[SDL] Audio initialized: %d Hz, %d channels\n", have.freq, have.channels);
         SDL_PauseAudioDevice(g_audio_device, 0); /* Start playing */
     }
@@ -252,43 +820,92 @@ bool gb_platform_init(int scale) {
     }
     fprintf(stderr, "[SDL] Window created.\n");
     
-    fprintf(stderr, "[SDL] Creating renderer...\n");
-    g_renderer = SDL_CreateRenderer(g_window, -1, 
-        SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
-        
-    if (!g_renderer) {
-        fprintf(stderr, "[SDL] Hardware renderer failed (flags=0x%x), trying software fallback...\n", 
-                SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
-        g_renderer = SDL_CreateRenderer(g_window, -1, SDL_RENDERER_SOFTWARE);
-    }
-        
-    if (!g_renderer) {
-        fprintf(stderr, "[SDL] SDL_CreateRenderer failed: %s\n", SDL_GetError());
+    /* With a presenter thread the renderer lives on that thread, so GPU
+       driver stalls in upload/present never block emulation */
+    bool ok = g_present_thread ? presenter_start() : create_renderer();
+    if (!ok) {
+        if (g_present_thread) presenter_stop();
         SDL_DestroyWindow(g_window);
         SDL_Quit();
         return false;
     }
     
-    SDL_SetHint(SDL_HINT_RENDER_SCALE_QUALITY, "nearest");
-    
-    g_texture = SDL_CreateTexture(
-        g_renderer,
-        SDL_PIXELFORMAT_ARGB8888,
-        SDL_TEXTUREACCESS_STREAMING,
-        GB_SCREEN_WIDTH,
-        GB_SCREEN_HEIGHT
-    );
+    return true;
+}
+
+/* Escape was pressed while key events were drained from get_joypad */
+static bool g_quit_requested = false;
+
+/* Rewind key is held */
+static bool g_rewind_held = false;
+
+/**
+ * @brief Apply a key event to g_joypad_*
+ * @return The pad a button was newly pressed on, or NULL
+ */
+static const uint8_t* handle_key(const SDL_KeyboardEvent* key) {
+    bool pressed = (key->type == SDL_KEYDOWN);
+    uint8_t* pad;
+    uint8_t bit;
     
-    if (!g_texture) {
-        SDL_DestroyRenderer(g_renderer);
-        SDL_DestroyWindow(g_window);
-        SDL_Quit();
-        return false;
+    switch (key->keysym.scancode) {
+        /* D-pad */
+        case SDL_SCANCODE_UP:
+        case SDL_SCANCODE_W:         pad = &g_joypad_dpad; bit = 0x04; break;
+        case SDL_SCANCODE_DOWN:
+        case SDL_SCANCODE_S:         pad = &g_joypad_dpad; bit = 0x08; break;
+        case SDL_SCANCODE_LEFT:
+        case SDL_SCANCODE_A:         pad = &g_joypad_dpad; bit = 0x02; break;
+        case SDL_SCANCODE_RIGHT:
+        case SDL_SCANCODE_D:         pad = &g_joypad_dpad; bit = 0x01; break;
+        
+        /* Buttons */
+        case SDL_SCANCODE_Z:
+        case SDL_SCANCODE_J:         pad = &g_joypad_buttons; bit = 0x01; break; /* A */
+        case SDL_SCANCODE_X:
+        case SDL_SCANCODE_K:         pad = &g_joypad_buttons; bit = 0x02; break; /* B */
+        case SDL_SCANCODE_RSHIFT:
+        case SDL_SCANCODE_BACKSPACE: pad = &g_joypad_buttons; bit = 0x04; break; /* Select */
+        case SDL_SCANCODE_RETURN:    pad = &g_joypad_buttons; bit = 0x08; break; /* Start */
+        
+        case SDL_SCANCODE_ESCAPE:
+            g_quit_requested = true;
+            return NULL;
+            
+        case SDL_SCANCODE_R:
+            g_rewind_held = pressed;
+            return NULL;
+            
+        default:
+            return NULL;
     }
     
-    g_last_frame_time = SDL_GetTicks();
+    if (!pressed) {
+        *pad |= bit;
+        return NULL;
+    }
+    *pad &= ~bit;
+    return key->repeat == 0 ? pad : NULL;
+}
+
+/**
+ * @brief get_joypad callback: take key events that arrived since the last poll
+ *
+ * Called by the runtime when the game reads JOYP, so a press made during
+ * the frame wait is seen by this frame instead of the next one.
+ */
+static uint8_t sdl_get_joypad(GBContext* ctx) {
+    (void)ctx;
+    SDL_Event events[16];
+    int count;
     
-    return true;
+    SDL_PumpEvents();
+    while ((count = SDL_PeepEvents(events, 16, SDL_GETEVENT, SDL_KEYDOWN, SDL_KEYUP)) > 0) {
+        for (int i = 0; i < count; i++) {
+            handle_key(&events[i].key);
+        }
+    }
+    return (uint8_t)((g_joypad_buttons & 0x0F) << 4 | (g_joypad_dpad & 0x0F));
 }
 
 bool gb_platform_poll_events(GBContext* ctx) {
@@ -296,6 +913,10 @@ bool gb_platform_poll_events(GBContext* ctx) {
     uint8_t joyp = ctx ? ctx->io[0x00] : 0xFF;
     bool dpad_selected = !(joyp & 0x10);
     bool buttons_selected = !(joyp & 0x20);
+    /* With get_joypad registered the runtime raises the interrupt itself */
+    bool raise_irq = ctx && !ctx->callbacks.get_joypad;
+    
+    if (g_quit_requested) return false;
     
     while (SDL_PollEvent(&event)) {
         switch (event.type) {
@@ -304,61 +925,11 @@ bool gb_platform_poll_events(GBContext* ctx) {
                 
             case SDL_KEYDOWN:
             case SDL_KEYUP: {
-                bool pressed = (event.type == SDL_KEYDOWN);
-                bool trigger = false;
-                
-                switch (event.key.keysym.scancode) {
-                    /* D-pad */
-                    case SDL_SCANCODE_UP:
-                    case SDL_SCANCODE_W:
-                        if (pressed) { g_joypad_dpad &= ~0x04; if (dpad_selected) trigger = true; }
-                        else g_joypad_dpad |= 0x04;
-                        break;
-                    case SDL_SCANCODE_DOWN:
-                    case SDL_SCANCODE_S:
-                        if (pressed) { g_joypad_dpad &= ~0x08; if (dpad_selected) trigger = true; }
-                        else g_joypad_dpad |= 0x08;
-                        break;
-                    case SDL_SCANCODE_LEFT:
-                    case SDL_SCANCODE_A:
-                        if (pressed) { g_joypad_dpad &= ~0x02; if (dpad_selected) trigger = true; }
-                        else g_joypad_dpad |= 0x02;
-                        break;
-                    case SDL_SCANCODE_RIGHT:
-                    case SDL_SCANCODE_D:
-                        if (pressed) { g_joypad_dpad &= ~0x01; if (dpad_selected) trigger = true; }
-                        else g_joypad_dpad |= 0x01;
-                        break;
-                    
-                    /* Buttons */
-                    case SDL_SCANCODE_Z:
-                    case SDL_SCANCODE_J:
-                        if (pressed) { g_joypad_buttons &= ~0x01; if (buttons_selected) trigger = true; } /* A */
-                        else g_joypad_buttons |= 0x01;
-                        break;
-                    case SDL_SCANCODE_X:
-                    case SDL_SCANCODE_K:
-                        if (pressed) { g_joypad_buttons &= ~0x02; if (buttons_selected) trigger = true; } /* B */
-                        else g_joypad_buttons |= 0x02;
-                        break;
-                    case SDL_SCANCODE_RSHIFT:
-                    case SDL_SCANCODE_BACKSPACE:
-                        if (pressed) { g_joypad_buttons &= ~0x04; if (buttons_selected) trigger = true; } /* Select */
-                        else g_joypad_buttons |= 0x04;
-                        break;
-                    case SDL_SCANCODE_RETURN:
-                        if (pressed) { g_joypad_buttons &= ~0x08; if (buttons_selected) trigger = true; } /* Start */
-                        else g_joypad_buttons |= 0x08;
-                        break;
-                    
-                    case SDL_SCANCODE_ESCAPE:
-                        return false;
-                        
-                    default:
-                        break;
-                }
+                const uint8_t* pad = handle_key(&event.key);
+                if (g_quit_requested) return false;
                 
-                if (trigger && ctx && event.key.repeat == 0) {
+                bool trigger = pad && (pad == &g_joypad_dpad ? dpad_selected : buttons_selected);
+                if (trigger && raise_irq) {
                     ctx->io[0x0F] |= 0x10; /* Request Joypad Interrupt */
                     /* Also wake up HALT state immediately if needed, though handle_interrupts does it */
                     if (ctx->halted) ctx->halted = 0;
@@ -387,7 +958,7 @@ bool gb_platform_poll_events(GBContext* ctx) {
              if ((~e->dpad & 0x0F) && dpad_selected) trigger = true;
              if ((~e->buttons & 0x0F) && buttons_selected) trigger = true;
              
-                if (trigger && ctx) {
+                if (trigger && raise_irq) {
                     /* Only trigger on initial press, not repeats or continuous hold */
                     /* But for automation, we just check frame range. We should only trigger on EDGE. */
                      if (g_frame_count == e->start_frame) {
@@ -413,14 +984,11 @@ void gb_platform_render_frame(const uint32_t* framebuffer) {
     g_frame_count++;
     
     /* Handle Screenshot Dumping */
-    for (int i = 0; i < g_dump_count; i++) {
-        if (g_dump_frames[i] == (uint32_t)g_frame_count) {
-             char filename[128];
-             snprintf(filename, sizeof(filename), "%s_%05d.ppm", g_screenshot_prefix, g_frame_count);
-             save_ppm(filename, framebuffer, GB_SCREEN_WIDTH, GB_SCREEN_HEIGHT, g_frame_count);
-        }
+    if (should_dump((uint32_t)g_frame_count)) {
+        capture_submit(framebuffer, g_frame_count);
     }
     
+#ifdef GB_DEBUG_FRAME
     /* Debug: check framebuffer content on first few frames */
     if (g_frame_count <= 3) {
         /* Check if framebuffer has any non-white pixels */
@@ -435,6 +1003,7 @@ void gb_platform_render_frame(const uint32_t* framebuffer) {
         DBG_FRAME("Platform frame %d - has_content=%d, first_pixel=0x%08X",
                   g_frame_count, has_content, framebuffer[0]);
     }
+#endif
     
     if (g_frame_count % 60 == 0) {
         char title[64];
@@ -442,13 +1011,17 @@ void gb_platform_render_frame(const uint32_t* framebuffer) {
         SDL_SetWindowTitle(g_window, title);
     }
     
-    /* Update texture */
-    SDL_UpdateTexture(g_texture, NULL, framebuffer, GB_SCREEN_WIDTH * sizeof(uint32_t));
-    
-    /* Clear and render */
-    SDL_RenderClear(g_renderer);
-    SDL_RenderCopy(g_renderer, g_texture, NULL, NULL);
-    SDL_RenderPresent(g_renderer);
+    /* Skip the upload when the PPU reports an identical frame */
+    bool changed = !g_ctx || gb_frame_changed(g_ctx);
+    if (g_present_thread) {
+        if (changed) publish_frame(framebuffer);
+        SDL_SemPost(g_frame_sem);
+        return;
+    }
+    if (changed) {
+        upload_frame(framebuffer);
+    }
+    present();
 }
 
 uint8_t gb_platform_get_joypad(void) {
@@ -457,17 +1030,148 @@ uint8_t gb_platform_get_joypad(void) {
     return g_joypad_buttons & g_joypad_dpad;
 }
 
-void gb_platform_vsync(void) {
-    /* Target 59.7 FPS */
-    const uint32_t frame_time_ms = 16;  /* ~60 FPS */
-    uint32_t current_time = SDL_GetTicks();
-    uint32_t elapsed = current_time - g_last_frame_time;
+bool gb_platform_rewind_held(void) {
+    return g_rewind_held;
+}
+
+void gb_platform_set_auto_frameskip(bool enabled) {
+    g_auto_frameskip = enabled;
+    g_auto_skipped = 0;
+}
+
+/**
+ * @brief Skip drawing the next frame if audio output is about to run dry
+ *
+ * The audio device drains the ring at the real sample rate, so a low fill
+ * level means emulation is running behind. Returns true when behind.
+ */
+static bool auto_frameskip_check(void) {
+    if (!g_auto_frameskip || !g_audio_device || !g_ctx) return false;
+    
+    int buffered = (int)audio_ring_fill(&g_audio_ring);
+    if (buffered >= AUTO_FRAMESKIP_LOW_WATER || g_auto_skipped >= AUTO_FRAMESKIP_MAX) {
+        g_auto_skipped = 0;
+        return false;
+    }
+    gb_skip_next_frame(g_ctx);
+    g_auto_skipped++;
+    return true;
+}
+
+/* ============================================================================
+ * Frame Pacing
+ *
+ * Emulation is paced by the audio device clock: after each frame we wait
+ * until the queued audio has drained to a target level, however long that
+ * takes. Small drift between the Game Boy's 59.73 Hz and the audio/display
+ * clocks is absorbed by dynamic rate control, which nudges the APU output
+ * rate up to 0.5% around the device rate depending on the fill level.
+ * With GB_PACING_VSYNC, SDL_RenderPresent waits for the display instead
+ * and rate control alone keeps audio in step.
+ * ========================================================================== */
+
+/* LCD frame period: 70224 cycles at 4194304 Hz */
+#define GB_FRAME_SECONDS (70224.0 / 4194304.0)
+
+/* Queued audio to hold: about two frames */
+#define PACING_TARGET_FRAMES ((uint32_t)g_audio_rate / 30)
+
+/* Largest rate adjustment, and the number of steps it is quantized into
+   (coarse steps avoid reconfiguring the APU every frame) */
+#define PACING_MAX_RATE_DELTA 0.005
+#define PACING_RATE_STEPS 10
+
+/* Longest a single audio wait may take before giving up (stalled device) */
+#define PACING_MAX_WAIT_MS 100
+
+static uint32_t g_rate_requested = 0;
+static uint64_t g_next_deadline = 0;
+
+/**
+ * @brief Dynamic rate control: steer the APU rate toward the target fill
+ */
+static void update_audio_rate(void) {
+    if (!g_audio_device || !g_ctx) return;
+    
+    double target = (double)PACING_TARGET_FRAMES;
+    double error = (target - (double)audio_ring_fill(&g_audio_ring)) / target;
+    if (error > 1.0) error = 1.0;
+    if (error < -1.0) error = -1.0;
+    
+    double step = (double)(int)(error * PACING_RATE_STEPS + (error < 0 ? -0.5 : 0.5));
+    uint32_t rate = (uint32_t)(g_audio_rate * (1.0 + PACING_MAX_RATE_DELTA * step / PACING_RATE_STEPS) + 0.5);
+    if (rate != g_rate_requested) {
+        gb_set_audio_format(g_ctx, rate, GB_SAMPLE_S16, 2);
+        g_rate_requested = rate;
+    }
+}
+
+/**
+ * @brief Sleep until the audio ring has drained to the target level
+ */
+static void wait_for_audio(void) {
+    uint32_t start = SDL_GetTicks();
     
-    if (elapsed < frame_time_ms) {
-        SDL_Delay(frame_time_ms - elapsed);
+    for (;;) {
+        uint32_t fill = audio_ring_fill(&g_audio_ring);
+        if (fill <= PACING_TARGET_FRAMES) break;
+        if (SDL_GetTicks() - start >= PACING_MAX_WAIT_MS) break;
+        
+        uint32_t ms = (fill - PACING_TARGET_FRAMES) * 1000u / (uint32_t)g_audio_rate;
+        SDL_Delay(ms ? ms : 1);
     }
+}
+
+/**
+ * @brief Without an audio device: sleep to an accumulating frame deadline
+ *
+ * Deadlines advance by the exact LCD frame period, so rounding in
+ * individual sleeps never accumulates into drift.
+ */
+static void wait_for_deadline(void) {
+    uint64_t freq = SDL_GetPerformanceFrequency();
+    uint64_t period = (uint64_t)(freq * GB_FRAME_SECONDS);
+    uint64_t now = SDL_GetPerformanceCounter();
+    
+    /* First frame, or too far behind to catch up: restart the schedule */
+    if (g_next_deadline == 0 || now > g_next_deadline + period * 4) {
+        g_next_deadline = now;
+    }
+    g_next_deadline += period;
+    
+    while ((now = SDL_GetPerformanceCounter()) < g_next_deadline) {
+        uint32_t ms = (uint32_t)((g_next_deadline - now) * 1000 / freq);
+        if (ms == 0) break;
+        SDL_Delay(ms);
+    }
+}
+
+void gb_platform_set_pacing(GBPacingMode mode) {
+    g_pacing = mode;
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+    /* The presenter's renderer belongs to that thread and keeps its mode */
+    if (g_renderer && !g_presenter) SDL_RenderSetVSync(g_renderer, mode == GB_PACING_VSYNC);
+#endif
+}
+
+void gb_platform_vsync(void) {
+    update_audio_rate();
     
-    g_last_frame_time = SDL_GetTicks();
+    /* Behind the audio clock: skip the next frame's drawing and don't sleep */
+    if (auto_frameskip_check()) return;
+    
+    if (g_pacing == GB_PACING_VSYNC) {
+        /* SDL_RenderPresent waits for the display; on the presenter
+           thread, wait for it to get there */
+        if (g_presenter) SDL_SemWaitTimeout(g_present_sem, PACING_MAX_WAIT_MS);
+        return;
+    }
+    /* Rewound frames produce no audio to pace against */
+    if (g_audio_device && !g_rewind_held) {
+        wait_for_audio();
+    } else {
+        wait_for_deadline();
+    }
 }
 
 void gb_platform_set_title(const char* title) {
@@ -477,16 +1181,45 @@ void gb_platform_set_title(const char* title) {
 }
 
 void gb_platform_register_context(GBContext* ctx) {
+    g_ctx = ctx;
     GBPlatformCallbacks callbacks = {
-        .on_audio_sample = on_audio_sample
+        .on_audio_block = on_audio_block,
+        .get_joypad = sdl_get_joypad
     };
     gb_set_platform_callbacks(ctx, &callbacks);
+    gb_set_audio_format(ctx, (uint32_t)g_audio_rate, GB_SAMPLE_S16, 2);
+    g_rate_requested = (uint32_t)g_audio_rate;
+    if (g_presenter) {
+        /* The PPU converts each frame straight into the back slot */
+        gb_set_video_buffer(ctx, g_frame_slots[g_back_slot], 0);
+    }
 }
 
 #else  /* !GB_HAS_SDL2 */
 
 /* Stub implementations when SDL2 is not available */
 
+/* Joypad state - read by gbrt.c when no get_joypad callback is set */
+uint8_t g_joypad_buttons = 0xFF;
+uint8_t g_joypad_dpad = 0xFF;
+
+void gb_platform_set_input_script(const char* script) {
+    (void)script;
+}
+
+void gb_platform_set_dump_frames(const char* frames) {
+    (void)frames;
+}
+
+void gb_platform_set_screenshot_prefix(const char* prefix) {
+    (void)prefix;
+}
+
+void gb_platform_set_capture(GBCaptureFormat format, GBCapturePolicy policy) {
+    (void)format;
+    (void)policy;
+}
+
 bool gb_platform_init(int scale) {
     (void)scale;
     return false;
@@ -507,8 +1240,29 @@ uint8_t gb_platform_get_joypad(void) {
     return 0xFF;
 }
 
+bool gb_platform_rewind_held(void) {
+    return false;
+}
+
 void gb_platform_vsync(void) {}
 
+void gb_platform_set_auto_frameskip(bool enabled) {
+    (void)enabled;
+}
+
+void gb_platform_set_pacing(GBPacingMode mode) {
+    (void)mode;
+}
+
+void gb_platform_set_present_thread(bool enabled) {
+    (void)enabled;
+}
+
+void gb_platform_get_audio_stats(uint32_t* underruns, uint32_t* overruns) {
+    if (underruns) *underruns = 0;
+    if (overruns) *overruns = 0;
+}
+
 void gb_platform_set_title(const char* title) {
     (void)title;
 }
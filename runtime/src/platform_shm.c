@@ -0,0 +1,411 @@
+/**
+ * @file platform_shm.c
+ * @brief Shared-memory platform backend: frame/audio rings and socket input
+ */
+
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200809L  /* shm_open, clock_gettime, nanosleep */
+#endif
+
+#include "platform_shm.h"
+#include "ppu.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef _WIN32
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdatomic.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+/* ============================================================================
+ * Definitions
+ * ========================================================================== */
+
+#define DEFAULT_SAMPLE_RATE    44100
+#define DEFAULT_AUDIO_CAPACITY 16384
+#define PAGE_ALIGN(x) (((x) + 4095u) & ~4095u)
+
+#define GB_CLOCK_HZ 4194304
+
+/* More than this behind real time (e.g. after a stall) resets the pacing
+   baseline instead of running flat out to catch up */
+#define MAX_PACING_LAG_NS 100000000LL
+
+#define MAX_INPUT_CLIENTS 8
+
+/* The header's atomic fields are plain integers so consumers in any
+   language can map it; this side accesses them as C11 atomics */
+#define ATOMIC64(field) ((_Atomic uint64_t*)&(field))
+#define ATOMIC32(field) ((_Atomic uint32_t*)&(field))
+
+/* ============================================================================
+ * State
+ * ========================================================================== */
+
+static GBContext* g_ctx = NULL;
+
+static char g_name[256];
+static GBShmHeader* g_header = NULL;
+static size_t g_map_size = 0;
+static uint8_t* g_audio_ring = NULL;
+static size_t g_audio_frame_bytes = 0;
+static size_t g_frame_bytes = 0;
+
+static int g_slot = 0;                /* Slot the PPU is rendering into */
+static uint64_t g_total_cycles = 0;   /* Emulated hardware cycles since init */
+static uint32_t g_last_cycles = 0;    /* ctx->cycles at the last submit */
+
+static bool g_paced = true;
+static struct timespec g_pace_start;
+static uint64_t g_pace_cycles = 0;    /* g_total_cycles at g_pace_start */
+
+static char g_socket_path[sizeof(((struct sockaddr_un*)0)->sun_path)];
+static int g_listen_fd = -1;
+static int g_clients[MAX_INPUT_CLIENTS];
+static int g_client_count = 0;
+static uint8_t g_input_state = 0xFF;  /* Active low, as returned by get_joypad */
+
+static bool g_atexit_registered = false;
+
+/* ============================================================================
+ * Video
+ * ========================================================================== */
+
+static uint32_t* slot_pixels(int slot) {
+    return (uint32_t*)((uint8_t*)g_header + g_header->frame_offset + (size_t)slot * g_header->frame_stride);
+}
+
+/**
+ * @brief Point the PPU at a slot; readers see seq 0 until it is published
+ */
+static void begin_slot(GBContext* ctx, int slot) {
+    atomic_store_explicit(ATOMIC64(g_header->slots[slot].seq), 0, memory_order_relaxed);
+    /* A release store alone lets the pixel stores that follow become
+       visible first; the fence pairs with the reader's acquire fence */
+    atomic_thread_fence(memory_order_release);
+    g_slot = slot;
+    gb_set_video_buffer(ctx, slot_pixels(slot), 0);
+}
+
+static int64_t elapsed_ns(const struct timespec* since) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (int64_t)(now.tv_sec - since->tv_sec) * 1000000000LL + (now.tv_nsec - since->tv_nsec);
+}
+
+/**
+ * @brief Sleep until wall time catches up with emulated time
+ */
+static void pace(void) {
+    int64_t target = (int64_t)((g_total_cycles - g_pace_cycles) * 1000000000ULL / GB_CLOCK_HZ);
+    int64_t ahead = target - elapsed_ns(&g_pace_start);
+    if (ahead > 0) {
+        struct timespec ts = { (time_t)(ahead / 1000000000LL), (long)(ahead % 1000000000LL) };
+        while (nanosleep(&ts, &ts) != 0 && errno == EINTR) {}
+    } else if (ahead < -MAX_PACING_LAG_NS) {
+        clock_gettime(CLOCK_MONOTONIC, &g_pace_start);
+        g_pace_cycles = g_total_cycles;
+    }
+}
+
+static void poll_input(void);
+
+void gb_shm_submit_frame(GBContext* ctx) {
+    if (!g_header) return;
+
+    uint32_t delta = (uint32_t)(ctx->cycles - g_last_cycles);
+    g_last_cycles = ctx->cycles;
+    g_total_cycles += delta;
+
+    /* With the LCD off the PPU converts nothing, so the slot would still
+       hold a frame from a lap ago; repeat the last published frame */
+    uint64_t seq = atomic_load_explicit(ATOMIC64(g_header->frame_seq), memory_order_relaxed);
+    if (!(ctx->io[0x40] & 0x80) && seq > 0) {
+        int prev = (int)((seq - 1) % GB_SHM_FRAME_SLOTS);
+        memcpy(slot_pixels(g_slot), slot_pixels(prev), g_frame_bytes);
+    }
+
+    GBShmSlot* slot = &g_header->slots[g_slot];
+    slot->cycles = g_total_cycles;
+    slot->audio_seq = atomic_load_explicit(ATOMIC64(g_header->audio_seq), memory_order_relaxed);
+    atomic_store_explicit(ATOMIC64(slot->seq), seq + 1, memory_order_release);
+    atomic_store_explicit(ATOMIC64(g_header->frame_seq), seq + 1, memory_order_release);
+
+    begin_slot(ctx, (int)((seq + 1) % GB_SHM_FRAME_SLOTS));
+
+    poll_input();
+    if (g_paced) pace();
+}
+
+/* ============================================================================
+ * Audio
+ * ========================================================================== */
+
+static void on_audio_block(GBContext* ctx, const void* samples, size_t frames) {
+    (void)ctx;
+    uint32_t capacity = g_header->audio_capacity;
+    uint64_t seq = atomic_load_explicit(ATOMIC64(g_header->audio_seq), memory_order_relaxed);
+    const uint8_t* src = (const uint8_t*)samples;
+
+    /* Only the newest capacity frames can be kept anyway */
+    if (frames > capacity) {
+        src += (frames - capacity) * g_audio_frame_bytes;
+        seq += frames - capacity;
+        frames = capacity;
+    }
+
+    /* Announce the frames about to be overwritten before touching them,
+       so a reader re-checking audio_write_seq after its copy notices */
+    atomic_store_explicit(ATOMIC64(g_header->audio_write_seq), seq + frames, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    size_t pos = (size_t)(seq & (capacity - 1));
+    size_t first = capacity - pos < frames ? capacity - pos : frames;
+    memcpy(g_audio_ring + pos * g_audio_frame_bytes, src, first * g_audio_frame_bytes);
+    memcpy(g_audio_ring, src + first * g_audio_frame_bytes, (frames - first) * g_audio_frame_bytes);
+
+    atomic_store_explicit(ATOMIC64(g_header->audio_seq), seq + frames, memory_order_release);
+}
+
+/* ============================================================================
+ * Input
+ * ========================================================================== */
+
+static bool set_nonblocking(int fd) {
+    int flags = fcntl(fd, F_GETFL, 0);
+    return flags >= 0 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
+static bool open_input_socket(const char* path) {
+    struct sockaddr_un addr;
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        fprintf(stderr, "[SHM] Socket path too long: %s\n", path);
+        return false;
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+
+    g_listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (g_listen_fd < 0) return false;
+
+    unlink(path);  /* Stale socket from an earlier run */
+    if (bind(g_listen_fd, (struct sockaddr*)&addr, sizeof(addr)) != 0 ||
+        listen(g_listen_fd, MAX_INPUT_CLIENTS) != 0 ||
+        !set_nonblocking(g_listen_fd)) {
+        fprintf(stderr, "[SHM] Cannot listen on %s: %s\n", path, strerror(errno));
+        close(g_listen_fd);
+        g_listen_fd = -1;
+        return false;
+    }
+    strcpy(g_socket_path, path);
+    return true;
+}
+
+/**
+ * @brief Accept new clients and apply every state byte received since the
+ *        last poll (the last byte wins)
+ */
+static void poll_input(void) {
+    if (g_listen_fd < 0) return;
+
+    int fd;
+    while ((fd = accept(g_listen_fd, NULL, NULL)) >= 0) {
+        if (g_client_count == MAX_INPUT_CLIENTS || !set_nonblocking(fd)) {
+            close(fd);
+            continue;
+        }
+        g_clients[g_client_count++] = fd;
+    }
+
+    for (int i = 0; i < g_client_count;) {
+        uint8_t buf[64];
+        ssize_t n;
+        while ((n = recv(g_clients[i], buf, sizeof(buf), 0)) > 0) {
+            g_input_state = buf[n - 1];
+        }
+        if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+            close(g_clients[i]);
+            g_clients[i] = g_clients[--g_client_count];
+            continue;
+        }
+        i++;
+    }
+}
+
+/**
+ * @brief get_joypad callback: take state bytes that arrived since the last poll
+ */
+static uint8_t shm_get_joypad(GBContext* ctx) {
+    (void)ctx;
+    poll_input();
+    return g_input_state;
+}
+
+/* ============================================================================
+ * Backend
+ * ========================================================================== */
+
+static void shm_atexit(void) {
+    gb_shm_shutdown();
+}
+
+static uint32_t round_pow2(uint32_t v) {
+    uint32_t p = 1;
+    while (p < v && p < 0x80000000u) p <<= 1;
+    return p;
+}
+
+bool gb_shm_init(GBContext* ctx, const GBShmConfig* config) {
+    if (!config->name || strlen(config->name) >= sizeof(g_name)) {
+        fprintf(stderr, "[SHM] Invalid shared memory name\n");
+        return false;
+    }
+    g_ctx = ctx;
+
+    uint32_t rate = config->sample_rate ? config->sample_rate : DEFAULT_SAMPLE_RATE;
+    int channels = config->channels ? config->channels : 2;
+    uint32_t capacity = round_pow2(config->audio_capacity ? config->audio_capacity : DEFAULT_AUDIO_CAPACITY);
+    if (!gb_set_audio_format(ctx, rate, config->sample_format, channels)) {
+        fprintf(stderr, "[SHM] Audio output setup failed\n");
+        return false;
+    }
+    g_audio_frame_bytes = (size_t)channels * (config->sample_format == GB_SAMPLE_F32 ? 4 : 2);
+
+    int factor = ppu_scale_factor(config->scale);
+    g_frame_bytes = (size_t)GB_FRAMEBUFFER_SIZE * 4 * factor * factor;
+    uint32_t frame_offset = PAGE_ALIGN((uint32_t)sizeof(GBShmHeader));
+    uint32_t frame_stride = PAGE_ALIGN((uint32_t)g_frame_bytes);
+    uint32_t audio_offset = frame_offset + frame_stride * GB_SHM_FRAME_SLOTS;
+    g_map_size = audio_offset + (size_t)capacity * g_audio_frame_bytes;
+
+    int fd = shm_open(config->name, O_CREAT | O_RDWR, 0600);
+    if (fd < 0) {
+        fprintf(stderr, "[SHM] shm_open(%s) failed: %s\n", config->name, strerror(errno));
+        return false;
+    }
+    /* Shrink first so a leftover object from an earlier run is zeroed */
+    if (ftruncate(fd, 0) != 0 || ftruncate(fd, (off_t)g_map_size) != 0) {
+        fprintf(stderr, "[SHM] Cannot size %s: %s\n", config->name, strerror(errno));
+        close(fd);
+        shm_unlink(config->name);
+        return false;
+    }
+    void* map = mmap(NULL, g_map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        fprintf(stderr, "[SHM] mmap failed: %s\n", strerror(errno));
+        shm_unlink(config->name);
+        return false;
+    }
+    strcpy(g_name, config->name);
+
+    g_header = (GBShmHeader*)map;
+    g_header->version = GB_SHM_VERSION;
+    g_header->header_size = sizeof(GBShmHeader);
+    g_header->width = GB_SCREEN_WIDTH * factor;
+    g_header->height = GB_SCREEN_HEIGHT * factor;
+    g_header->pitch = GB_SCREEN_WIDTH * factor * 4;
+    g_header->frame_slots = GB_SHM_FRAME_SLOTS;
+    g_header->frame_offset = frame_offset;
+    g_header->frame_stride = frame_stride;
+    g_header->sample_rate = rate;
+    g_header->sample_format = (uint32_t)config->sample_format;
+    g_header->channels = (uint32_t)channels;
+    g_header->audio_offset = audio_offset;
+    g_header->audio_capacity = capacity;
+    g_audio_ring = (uint8_t*)map + audio_offset;
+    /* Consumers wait for the magic before trusting the rest */
+    atomic_store_explicit(ATOMIC32(g_header->magic), GB_SHM_MAGIC, memory_order_release);
+
+    g_client_count = 0;
+    g_input_state = 0xFF;
+    if (config->input_socket && !open_input_socket(config->input_socket)) {
+        gb_shm_shutdown();
+        return false;
+    }
+
+    /* Deferred frames are published one frame late, so each slot's cycles
+       and audio_seq stamp would be a frame ahead of the pixels it holds */
+    gb_set_deferred_rendering(ctx, false);
+    g_last_cycles = ctx->cycles;
+    g_total_cycles = 0;
+    gb_set_video_scale(ctx, config->scale);
+    begin_slot(ctx, 0);
+
+    GBPlatformCallbacks callbacks = ctx->callbacks;
+    callbacks.on_audio_block = on_audio_block;
+    callbacks.on_audio_sample = NULL;
+    if (g_listen_fd >= 0) callbacks.get_joypad = shm_get_joypad;
+    gb_set_platform_callbacks(ctx, &callbacks);
+
+    g_paced = !config->unpaced;
+    clock_gettime(CLOCK_MONOTONIC, &g_pace_start);
+    g_pace_cycles = 0;
+
+    if (!g_atexit_registered) {
+        atexit(shm_atexit);
+        g_atexit_registered = true;
+    }
+    printf("[SHM] Streaming to %s (%u Hz, %d ch)%s%s\n", g_name, rate, channels,
+           g_listen_fd >= 0 ? ", input on " : "", g_listen_fd >= 0 ? g_socket_path : "");
+    return true;
+}
+
+void gb_shm_shutdown(void) {
+    if (g_ctx) {
+        /* Drain the audio worker before the ring goes away */
+        gb_set_audio_thread(g_ctx, false);
+        gb_set_video_buffer(g_ctx, NULL, 0);
+        gb_set_video_scale(g_ctx, GB_SCALE_NONE);
+
+        GBPlatformCallbacks callbacks = g_ctx->callbacks;
+        if (callbacks.on_audio_block == on_audio_block) callbacks.on_audio_block = NULL;
+        if (callbacks.get_joypad == shm_get_joypad) callbacks.get_joypad = NULL;
+        gb_set_platform_callbacks(g_ctx, &callbacks);
+        g_ctx = NULL;
+    }
+
+    for (int i = 0; i < g_client_count; i++) close(g_clients[i]);
+    g_client_count = 0;
+    if (g_listen_fd >= 0) {
+        close(g_listen_fd);
+        unlink(g_socket_path);
+        g_listen_fd = -1;
+    }
+
+    if (g_header) {
+        /* Mapped consumers keep the memory; the name goes away */
+        atomic_store_explicit(ATOMIC32(g_header->closed), 1, memory_order_release);
+        munmap(g_header, g_map_size);
+        shm_unlink(g_name);
+        g_header = NULL;
+        g_audio_ring = NULL;
+    }
+}
+
+#else /* _WIN32 */
+
+bool gb_shm_init(GBContext* ctx, const GBShmConfig* config) {
+    (void)ctx;
+    (void)config;
+    fprintf(stderr, "[SHM] Shared-memory output needs a POSIX system\n");
+    return false;
+}
+
+void gb_shm_submit_frame(GBContext* ctx) {
+    (void)ctx;
+}
+
+void gb_shm_shutdown(void) {
+}
+
+#endif /* _WIN32 */
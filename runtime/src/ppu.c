@@ -5,9 +5,24 @@
 
 #include "ppu.h"
 #include "gbrt.h"
+#include "savestate.h"
 #include "gbrt_debug.h"
 #include <string.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define PPU_SIMD_SSE2 1
+#include <emmintrin.h>
+#if defined(__GNUC__)
+#define PPU_SIMD_AVX2 1
+#include <immintrin.h>
+#endif
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#define PPU_SIMD_NEON 1
+#include <arm_neon.h>
+#endif
 
 /* ============================================================================
  * Default Color Palette (DMG green shades)
@@ -20,11 +35,43 @@ static const uint32_t dmg_palette[4] = {
     0xFF081820,  /* Darkest (black) */
 };
 
+static void init_palette_kernels(void);
+static bool deferred_log_vram(GBPPU* ppu, uint16_t addr, uint8_t value);
+static void deferred_stop(GBPPU* ppu, const uint8_t* vram);
+static void deferred_submit_frame(GBPPU* ppu);
+
+/* ============================================================================
+ * Tile Row Decoding
+ * ========================================================================== */
+
+/**
+ * @brief Expand 8 bitplane pixels into one byte per pixel
+ *
+ * Byte i of tile_row_lut[b] holds bit (7 - i) of b, so a tile row decodes as
+ * lut[lo] | (lut[hi] << 1) with the leftmost pixel in byte 0.
+ */
+static uint64_t tile_row_lut[256];
+static bool tile_row_lut_ready = false;
+
+static void init_tile_row_lut(void) {
+    if (tile_row_lut_ready) return;
+    for (int b = 0; b < 256; b++) {
+        uint8_t px[8];
+        for (int i = 0; i < 8; i++) {
+            px[i] = (b >> (7 - i)) & 1;
+        }
+        memcpy(&tile_row_lut[b], px, sizeof(px));
+    }
+    tile_row_lut_ready = true;
+}
+
 /* ============================================================================
  * PPU Initialization
  * ========================================================================== */
 
 void ppu_init(GBPPU* ppu) {
+    init_tile_row_lut();
+    init_palette_kernels();
     memset(ppu, 0, sizeof(GBPPU));
     ppu_reset(ppu);
     DBG_PPU("PPU initialized");
@@ -51,6 +98,15 @@ void ppu_reset(GBPPU* ppu) {
     ppu->window_line = 0;
     ppu->window_triggered = false;
     ppu->frame_ready = false;
+    ppu->sprite_lists_dirty = true;
+    ppu->skip_phase = 0;
+    ppu->skip_next = false;
+    ppu->render_frame = !ppu->headless;
+    
+    /* Force every line to be drawn and the first frame to be converted */
+    memset(ppu->line_keys, 0, sizeof(ppu->line_keys));
+    ppu->frame_dirty = true;
+    ppu->frame_changed = true;
     
     /* Clear framebuffers */
     memset(ppu->framebuffer, 0, sizeof(ppu->framebuffer));
@@ -90,14 +146,68 @@ static uint16_t get_window_tilemap_addr(GBPPU* ppu) {
     return (ppu->lcdc & LCDC_WINDOW_TILEMAP) ? 0x9C00 : 0x9800;
 }
 
-/**
- * @brief Read a byte from VRAM
- */
-static uint8_t vram_read(GBContext* ctx, uint16_t addr) {
-    if (addr >= 0x8000 && addr <= 0x9FFF) {
-        return ctx->vram[addr - 0x8000];
+/* ============================================================================
+ * Tile Cache
+ * ========================================================================== */
+
+static void decode_tile_row(GBPPU* ppu, const uint8_t* vram, uint8_t bank, uint16_t tile, uint8_t row) {
+    const uint8_t* data = vram + bank * VRAM_SIZE + tile * TILE_SIZE + row * 2;
+    uint64_t bits = tile_row_lut[data[0]] | (tile_row_lut[data[1]] << 1);
+    uint8_t* px = ppu->tile_cache[bank][tile][row];
+    uint8_t* flip = ppu->tile_cache_flip[bank][tile][row];
+    
+    memcpy(px, &bits, 8);
+    for (int i = 0; i < 8; i++) {
+        flip[i] = px[7 - i];
+    }
+}
+
+void ppu_vram_write(GBPPU* ppu, const uint8_t* vram, uint8_t bank, uint16_t offset) {
+    bank &= 1;
+    if (ppu->deferred) {
+        uint16_t addr = bank * VRAM_SIZE + offset;
+        /* A write the worker can't see would desync its VRAM copy for good;
+           render inline from live VRAM (which has the write) instead */
+        if (!deferred_log_vram(ppu, addr, vram[addr])) deferred_stop(ppu, vram);
+        return;
+    }
+    if (offset >= TILES_PER_BANK * TILE_SIZE) {
+        /* Tilemaps are read directly; just mark the 32-tile row as changed */
+        uint16_t map_offset = offset - TILES_PER_BANK * TILE_SIZE;
+        ppu->map_row_epoch[map_offset / 0x400][(map_offset % 0x400) / 32]++;
+        return;
+    }
+    decode_tile_row(ppu, vram, bank, offset / TILE_SIZE, (offset % TILE_SIZE) / 2);
+    ppu->tile_epoch++;
+}
+
+void ppu_rebuild_tile_cache(GBPPU* ppu, const uint8_t* vram) {
+    if (ppu->deferred) {
+        /* The worker has its own VRAM copy; resend all of it */
+        for (uint16_t addr = 0; addr < VRAM_SIZE * 2; addr++) {
+            if (!deferred_log_vram(ppu, addr, vram[addr])) {
+                deferred_stop(ppu, vram);
+                return;
+            }
+        }
+        return;
+    }
+    
+    for (uint8_t bank = 0; bank < 2; bank++) {
+        for (uint16_t tile = 0; tile < TILES_PER_BANK; tile++) {
+            for (uint8_t row = 0; row < 8; row++) {
+                decode_tile_row(ppu, vram, bank, tile, row);
+            }
+        }
+    }
+    
+    /* Everything may have changed */
+    ppu->tile_epoch++;
+    for (int map = 0; map < 2; map++) {
+        for (int row = 0; row < 32; row++) {
+            ppu->map_row_epoch[map][row]++;
+        }
     }
-    return 0xFF;
 }
 
 /* ============================================================================
@@ -111,92 +221,171 @@ static uint8_t apply_palette(uint8_t color, uint8_t palette) {
     return (palette >> (color * 2)) & 0x03;
 }
 
+/**
+ * @brief Get the decoded pixel row of a BG/window tile
+ */
+static inline const uint8_t* bg_tile_row(GBPPU* ppu, uint8_t tile_idx, uint8_t row) {
+    uint16_t tile = (get_tile_data_addr(ppu, tile_idx, false) - 0x8000) / TILE_SIZE;
+    return ppu->tile_cache[0][tile][row];
+}
+
+/**
+ * @brief Render a run of BG/window pixels from a tilemap, one tile at a time
+ *
+ * The map entry and decoded tile row are fetched once per 8-pixel span. Only the
+ * first and last tile can be partial; when map_x is tile-aligned (unscrolled
+ * BG, or the window) the whole run goes through the full-tile loop.
+ *
+ * @param line  Scanline in the index framebuffer
+ * @param x     First screen column to draw
+ * @param end   One past the last screen column to draw
+ * @param map   Tilemap base address (0x9800 or 0x9C00)
+ * @param map_x Tilemap pixel column shown at screen column x
+ * @param map_y Tilemap pixel row shown on this scanline
+ * @param shade Palette-applied shade for each color index
+ */
+static void render_tile_span(GBPPU* ppu, const uint8_t* vram, uint8_t* line, int x, int end,
+                             uint16_t map, uint8_t map_x, uint8_t map_y,
+                             const uint8_t shade[4]) {
+    const uint8_t* map_row = vram + (map - 0x8000) + (map_y / 8) * 32;
+    uint8_t tile_row = map_y % 8;
+    uint8_t tile_x = map_x / 8;
+    uint8_t fine_x = map_x % 8;
+    const uint8_t* px;
+    
+    /* Leading partial tile */
+    if (fine_x && x < end) {
+        px = bg_tile_row(ppu, map_row[tile_x++ & 31], tile_row);
+        while (fine_x < 8 && x < end) {
+            line[x++] = shade[px[fine_x++]];
+        }
+    }
+    
+    /* Full tiles */
+    while (x + 8 <= end) {
+        px = bg_tile_row(ppu, map_row[tile_x++ & 31], tile_row);
+        line[x + 0] = shade[px[0]];
+        line[x + 1] = shade[px[1]];
+        line[x + 2] = shade[px[2]];
+        line[x + 3] = shade[px[3]];
+        line[x + 4] = shade[px[4]];
+        line[x + 5] = shade[px[5]];
+        line[x + 6] = shade[px[6]];
+        line[x + 7] = shade[px[7]];
+        x += 8;
+    }
+    
+    /* Trailing partial tile */
+    if (x < end) {
+        px = bg_tile_row(ppu, map_row[tile_x & 31], tile_row);
+        for (int i = 0; x < end; i++) {
+            line[x++] = shade[px[i]];
+        }
+    }
+}
+
+/**
+ * @brief Check whether the window is drawn on the current scanline
+ */
+static bool window_visible(GBPPU* ppu) {
+    /* Note: on DMG, LCDC_BG_ENABLE (bit 0) also controls Master Enable (BG+Window). 
+       On CGB, it controls priority. Assuming DMG mostly here. */
+    return (ppu->lcdc & LCDC_BG_ENABLE) && (ppu->lcdc & LCDC_WINDOW_ENABLE) &&
+           (ppu->wx <= 166) && (ppu->wy <= ppu->ly);
+}
+
+/**
+ * @brief Step the window line counter for a line that is not being drawn
+ */
+static void advance_window_line(GBPPU* ppu) {
+    if (window_visible(ppu)) {
+        ppu->window_triggered = true;
+        ppu->window_line++;
+    }
+}
+
 /**
  * @brief Render background/window for current scanline
  */
-static void render_bg_scanline(GBPPU* ppu, GBContext* ctx) {
+static void render_bg_scanline(GBPPU* ppu, const uint8_t* vram) {
     uint8_t scanline = ppu->ly;
+    uint8_t* line = &ppu->framebuffer[scanline * GB_SCREEN_WIDTH];
     
     if (!(ppu->lcdc & LCDC_LCD_ENABLE)) {
         /* LCD disabled - blank line */
-        memset(&ppu->framebuffer[scanline * GB_SCREEN_WIDTH], 0, GB_SCREEN_WIDTH);
+        memset(line, 0, GB_SCREEN_WIDTH);
         return;
     }
     
     bool bg_enable = (ppu->lcdc & LCDC_BG_ENABLE);
-    /* Note: on DMG, LCDC_BG_ENABLE (bit 0) also controls Master Enable (BG+Window). 
-       On CGB, it controls priority. Assuming DMG mostly here. */
-    bool window_enable = bg_enable && (ppu->lcdc & LCDC_WINDOW_ENABLE) && (ppu->wx <= 166) && (ppu->wy <= scanline);
+    bool window_enable = window_visible(ppu);
     
     /* Track if window was triggered */
     if (window_enable && !ppu->window_triggered) {
         ppu->window_triggered = true;
     }
     
-    for (int x = 0; x < GB_SCREEN_WIDTH; x++) {
-        uint8_t color = 0;
-        
-        /* Check if we're in window area */
-        bool in_window = window_enable && (x >= (ppu->wx - 7));
-        
-        if (in_window) {
-            /* Render window */
-            int win_x = x - (ppu->wx - 7);
-            int win_y = ppu->window_line;
-            
-            /* Get tile from window tilemap */
-            uint16_t tilemap_addr = get_window_tilemap_addr(ppu);
-            uint8_t tile_x = win_x / 8;
-            uint8_t tile_y = win_y / 8;
-            uint8_t tile_idx = vram_read(ctx, tilemap_addr + tile_y * 32 + tile_x);
-            
-            /* Get pixel from tile */
-            uint16_t tile_addr = get_tile_data_addr(ppu, tile_idx, false);
-            uint8_t pixel_y = win_y % 8;
-            uint8_t pixel_x = win_x % 8;
-            
-            uint8_t lo = vram_read(ctx, tile_addr + pixel_y * 2);
-            uint8_t hi = vram_read(ctx, tile_addr + pixel_y * 2 + 1);
-            
-            uint8_t bit = 7 - pixel_x;
-            color = ((lo >> bit) & 1) | (((hi >> bit) & 1) << 1);
-        } else if (bg_enable) {
-            /* Render background */
-            int bg_x = (x + ppu->scx) & 0xFF;
-            int bg_y = (scanline + ppu->scy) & 0xFF;
-            
-            /* Get tile from background tilemap */
-            uint16_t tilemap_addr = get_bg_tilemap_addr(ppu);
-            uint8_t tile_x = bg_x / 8;
-            uint8_t tile_y = bg_y / 8;
-            uint8_t tile_idx = vram_read(ctx, tilemap_addr + tile_y * 32 + tile_x);
-            
-            /* Get pixel from tile */
-            uint16_t tile_addr = get_tile_data_addr(ppu, tile_idx, false);
-            uint8_t pixel_y = bg_y % 8;
-            uint8_t pixel_x = bg_x % 8;
-            
-            uint8_t lo = vram_read(ctx, tile_addr + pixel_y * 2);
-            uint8_t hi = vram_read(ctx, tile_addr + pixel_y * 2 + 1);
-            
-            uint8_t bit = 7 - pixel_x;
-            color = ((lo >> bit) & 1) | (((hi >> bit) & 1) << 1);
-        }
-        
-        /* Apply palette and store */
-        ppu->framebuffer[scanline * GB_SCREEN_WIDTH + x] = apply_palette(color, ppu->bgp);
+    uint8_t shade[4];
+    for (int i = 0; i < 4; i++) {
+        shade[i] = apply_palette(i, ppu->bgp);
+    }
+    
+    /* Window covers everything from WX-7 to the right edge */
+    int window_x = window_enable ? ppu->wx - 7 : GB_SCREEN_WIDTH;
+    if (window_x < 0) window_x = 0;
+    
+    if (bg_enable) {
+        render_tile_span(ppu, vram, line, 0, window_x, get_bg_tilemap_addr(ppu),
+                         ppu->scx, (uint8_t)(scanline + ppu->scy), shade);
+    } else {
+        memset(line, shade[0], GB_SCREEN_WIDTH);
     }
     
-    /* Increment window line counter if window was used */
-    if (ppu->window_triggered && window_enable) {
+    if (window_enable) {
+        render_tile_span(ppu, vram, line, window_x, GB_SCREEN_WIDTH, get_window_tilemap_addr(ppu),
+                         (uint8_t)(window_x - (ppu->wx - 7)), ppu->window_line, shade);
+        
+        /* Increment window line counter if window was used */
         ppu->window_line++;
     }
 }
 
+/**
+ * @brief Bucket OAM entries by the visible scanlines they cover
+ *
+ * Sprites are visited in OAM order, so each line keeps the first 10 that
+ * overlap it - the same selection the hardware OAM scan makes.
+ */
+static void build_sprite_lists(GBPPU* ppu, const uint8_t* oam) {
+    int sprite_height = (ppu->lcdc & LCDC_OBJ_SIZE) ? 16 : 8;
+    
+    memset(ppu->line_sprite_count, 0, sizeof(ppu->line_sprite_count));
+    for (int i = 0; i < 40; i++) {
+        const OAMEntry* sprite = (const OAMEntry*)(oam + i * 4);
+        int top = sprite->y - 16;
+        int first = (top < 0) ? 0 : top;
+        int last = top + sprite_height;
+        if (last > VISIBLE_SCANLINES) last = VISIBLE_SCANLINES;
+        
+        for (int line = first; line < last; line++) {
+            uint8_t count = ppu->line_sprite_count[line];
+            if (count < 10) {
+                ppu->line_sprites[line][count] = (uint8_t)i;
+                ppu->line_sprite_count[line] = count + 1;
+            }
+        }
+    }
+    ppu->sprite_lists_dirty = false;
+}
+
+void ppu_oam_write(GBPPU* ppu) {
+    ppu->sprite_lists_dirty = true;
+}
+
 /**
  * @brief Render sprites for current scanline
  */
-static void render_sprites_scanline(GBPPU* ppu, GBContext* ctx) {
+static void render_sprites_scanline(GBPPU* ppu, const uint8_t* oam) {
     if (!(ppu->lcdc & LCDC_OBJ_ENABLE)) {
         return;  /* Sprites disabled */
     }
@@ -204,22 +393,17 @@ static void render_sprites_scanline(GBPPU* ppu, GBContext* ctx) {
     uint8_t scanline = ppu->ly;
     uint8_t sprite_height = (ppu->lcdc & LCDC_OBJ_SIZE) ? 16 : 8;
     
-    /* Find sprites on this scanline (max 10) */
-    int sprite_count = 0;
-    int sprites[10];
-    
-    for (int i = 0; i < 40 && sprite_count < 10; i++) {
-        OAMEntry* sprite = (OAMEntry*)(ctx->oam + i * 4);
-        int sprite_y = sprite->y - 16;
-        
-        if (scanline >= sprite_y && scanline < sprite_y + sprite_height) {
-            sprites[sprite_count++] = i;
-        }
+    if (scanline >= VISIBLE_SCANLINES) return;
+    if (ppu->sprite_lists_dirty) {
+        build_sprite_lists(ppu, oam);
     }
     
+    int sprite_count = ppu->line_sprite_count[scanline];
+    const uint8_t* sprites = ppu->line_sprites[scanline];
+    
     /* Render sprites in reverse order (priority - lower index = higher priority) */
     for (int i = sprite_count - 1; i >= 0; i--) {
-        OAMEntry* sprite = (OAMEntry*)(ctx->oam + sprites[i] * 4);
+        const OAMEntry* sprite = (const OAMEntry*)(oam + sprites[i] * 4);
         int sprite_y = sprite->y - 16;
         int sprite_x = sprite->x - 8;
         
@@ -233,20 +417,19 @@ static void render_sprites_scanline(GBPPU* ppu, GBContext* ctx) {
             line = sprite_height - 1 - line;
         }
         
-        uint16_t tile_addr = 0x8000 + tile_idx * 16 + line * 2;
-        uint8_t lo = vram_read(ctx, tile_addr);
-        uint8_t hi = vram_read(ctx, tile_addr + 1);
+        /* 8x16 sprites continue into the next tile */
+        const uint8_t* px = (sprite->flags & OAM_FLIP_X)
+            ? ppu->tile_cache_flip[0][tile_idx + line / 8][line % 8]
+            : ppu->tile_cache[0][tile_idx + line / 8][line % 8];
         
         uint8_t palette = (sprite->flags & OAM_PALETTE) ? ppu->obp1 : ppu->obp0;
         bool behind_bg = (sprite->flags & OAM_PRIORITY);
         
-        for (int px = 0; px < 8; px++) {
-            int screen_x = sprite_x + px;
+        for (int col = 0; col < 8; col++) {
+            int screen_x = sprite_x + col;
             if (screen_x < 0 || screen_x >= GB_SCREEN_WIDTH) continue;
             
-            int bit_pos = (sprite->flags & OAM_FLIP_X) ? px : (7 - px);
-            uint8_t color = ((lo >> bit_pos) & 1) | (((hi >> bit_pos) & 1) << 1);
-            
+            uint8_t color = px[col];
             if (color == 0) continue;  /* Color 0 is transparent */
             
             /* Check priority */
@@ -258,40 +441,551 @@ static void render_sprites_scanline(GBPPU* ppu, GBContext* ctx) {
     }
 }
 
+/**
+ * @brief Collect the inputs the current scanline will be rendered from
+ */
+static void build_line_key(GBPPU* ppu, const uint8_t* oam, PPULineKey* key) {
+    uint8_t ly = ppu->ly;
+    
+    memset(key, 0, sizeof(*key));
+    key->lcdc = ppu->lcdc;
+    key->scx = ppu->scx;
+    key->scy = ppu->scy;
+    key->wx = ppu->wx;
+    key->wy = ppu->wy;
+    key->bgp = ppu->bgp;
+    key->obp0 = ppu->obp0;
+    key->obp1 = ppu->obp1;
+    key->window_line = ppu->window_line;
+    key->valid = 1;
+    key->tile_epoch = ppu->tile_epoch;
+    key->bg_map_epoch = ppu->map_row_epoch[(ppu->lcdc & LCDC_BG_TILEMAP) ? 1 : 0][(uint8_t)(ly + ppu->scy) / 8];
+    key->win_map_epoch = ppu->map_row_epoch[(ppu->lcdc & LCDC_WINDOW_TILEMAP) ? 1 : 0][ppu->window_line / 8];
+    
+    if (ppu->lcdc & LCDC_OBJ_ENABLE) {
+        if (ppu->sprite_lists_dirty) {
+            build_sprite_lists(ppu, oam);
+        }
+        key->sprite_count = ppu->line_sprite_count[ly];
+        for (int i = 0; i < key->sprite_count; i++) {
+            memcpy(&key->sprites[i * 4], oam + ppu->line_sprites[ly][i] * 4, 4);
+        }
+    }
+}
+
+/**
+ * @brief Draw the current line from the given VRAM/OAM, skipping it if unchanged
+ */
+static void render_line(GBPPU* ppu, const uint8_t* vram, const uint8_t* oam) {
+    uint8_t ly = ppu->ly;
+    
+    PPULineKey key;
+    build_line_key(ppu, oam, &key);
+    if (memcmp(&key, &ppu->line_keys[ly], sizeof(key)) == 0) {
+        /* Nothing this line depends on changed - keep last frame's pixels */
+        advance_window_line(ppu);
+        return;
+    }
+    
+    uint8_t* line = &ppu->framebuffer[ly * GB_SCREEN_WIDTH];
+    uint8_t previous[GB_SCREEN_WIDTH];
+    memcpy(previous, line, sizeof(previous));
+    
+    render_bg_scanline(ppu, vram);
+    render_sprites_scanline(ppu, oam);
+    
+    if (memcmp(previous, line, sizeof(previous)) != 0) {
+        ppu->frame_dirty = true;
+    }
+    ppu->line_keys[ly] = key;
+}
+
+static void deferred_log_line(GBPPU* ppu, GBContext* ctx);
+
 void ppu_render_scanline(GBPPU* ppu, GBContext* ctx) {
-    render_bg_scanline(ppu, ctx);
-    render_sprites_scanline(ppu, ctx);
+    if (ppu->ly >= VISIBLE_SCANLINES) return;
+    
+    if (!ppu->render_frame) {
+        /* Skipped frame: the framebuffer and line keys keep the last drawn
+           frame, so the next drawn frame still only redraws changed lines */
+        advance_window_line(ppu);
+    } else if (ppu->deferred) {
+        deferred_log_line(ppu, ctx);
+    } else {
+        render_line(ppu, ctx->vram, ctx->oam);
+    }
+}
+
+/* ============================================================================
+ * Palette Conversion
+ *
+ * The index framebuffer holds shades 0-3, so every output format reduces to
+ * a 4-entry lookup. Kernels are picked once at init from what the CPU
+ * supports; each converts one row.
+ * ========================================================================== */
+
+typedef void (*PaletteLut32Fn)(uint32_t* dst, const uint8_t* src, int count, const uint32_t pal[4]);
+typedef void (*PaletteLut16Fn)(uint16_t* dst, const uint8_t* src, int count, const uint16_t pal[4]);
+
+static void lut32_scalar(uint32_t* dst, const uint8_t* src, int count, const uint32_t pal[4]) {
+    for (int i = 0; i < count; i++) {
+        dst[i] = pal[src[i] & 0x03];
+    }
+}
+
+static void lut16_scalar(uint16_t* dst, const uint8_t* src, int count, const uint16_t pal[4]) {
+    for (int i = 0; i < count; i++) {
+        dst[i] = pal[src[i] & 0x03];
+    }
+}
+
+#if PPU_SIMD_SSE2
+/* SSE2 has no byte shuffle, so select each entry with compare masks */
+static inline __m128i sse2_select4(__m128i idx, const __m128i p[4]) {
+    __m128i out = p[0];
+    for (int k = 1; k < 4; k++) {
+        __m128i m = _mm_cmpeq_epi32(idx, _mm_set1_epi32(k));
+        out = _mm_or_si128(_mm_andnot_si128(m, out), _mm_and_si128(m, p[k]));
+    }
+    return out;
+}
+
+static void lut32_sse2(uint32_t* dst, const uint8_t* src, int count, const uint32_t pal[4]) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i mask = _mm_set1_epi8(0x03);
+    __m128i p[4];
+    for (int k = 0; k < 4; k++) p[k] = _mm_set1_epi32((int)pal[k]);
+    
+    int i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m128i idx = _mm_and_si128(_mm_loadu_si128((const __m128i*)(src + i)), mask);
+        __m128i lo = _mm_unpacklo_epi8(idx, zero);
+        __m128i hi = _mm_unpackhi_epi8(idx, zero);
+        _mm_storeu_si128((__m128i*)(dst + i + 0),  sse2_select4(_mm_unpacklo_epi16(lo, zero), p));
+        _mm_storeu_si128((__m128i*)(dst + i + 4),  sse2_select4(_mm_unpackhi_epi16(lo, zero), p));
+        _mm_storeu_si128((__m128i*)(dst + i + 8),  sse2_select4(_mm_unpacklo_epi16(hi, zero), p));
+        _mm_storeu_si128((__m128i*)(dst + i + 12), sse2_select4(_mm_unpackhi_epi16(hi, zero), p));
+    }
+    lut32_scalar(dst + i, src + i, count - i, pal);
+}
+
+static void lut16_sse2(uint16_t* dst, const uint8_t* src, int count, const uint16_t pal[4]) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i mask = _mm_set1_epi8(0x03);
+    __m128i p[4];
+    for (int k = 0; k < 4; k++) p[k] = _mm_set1_epi16((short)pal[k]);
+    
+    int i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m128i idx = _mm_and_si128(_mm_loadu_si128((const __m128i*)(src + i)), mask);
+        __m128i half[2] = { _mm_unpacklo_epi8(idx, zero), _mm_unpackhi_epi8(idx, zero) };
+        for (int h = 0; h < 2; h++) {
+            __m128i out = p[0];
+            for (int k = 1; k < 4; k++) {
+                __m128i m = _mm_cmpeq_epi16(half[h], _mm_set1_epi16((short)k));
+                out = _mm_or_si128(_mm_andnot_si128(m, out), _mm_and_si128(m, p[k]));
+            }
+            _mm_storeu_si128((__m128i*)(dst + i + h * 8), out);
+        }
+    }
+    lut16_scalar(dst + i, src + i, count - i, pal);
+}
+#endif
+
+#if PPU_SIMD_AVX2
+/* AVX2 can index the palette directly with a cross-lane permute */
+__attribute__((target("avx2")))
+static void lut32_avx2(uint32_t* dst, const uint8_t* src, int count, const uint32_t pal[4]) {
+    const __m256i table = _mm256_setr_epi32((int)pal[0], (int)pal[1], (int)pal[2], (int)pal[3],
+                                            (int)pal[0], (int)pal[1], (int)pal[2], (int)pal[3]);
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256i idx = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(src + i)));
+        _mm256_storeu_si256((__m256i*)(dst + i), _mm256_permutevar8x32_epi32(table, idx));
+    }
+    lut32_scalar(dst + i, src + i, count - i, pal);
+}
+#endif
+
+#if PPU_SIMD_NEON
+/* NEON looks up each byte plane with TBL and interleaves on store */
+static void lut32_neon(uint32_t* dst, const uint8_t* src, int count, const uint32_t pal[4]) {
+    uint8_t planes[4][16] = {{0}};
+    for (int k = 0; k < 4; k++) {
+        uint8_t bytes[4];
+        memcpy(bytes, &pal[k], 4);
+        for (int b = 0; b < 4; b++) planes[b][k] = bytes[b];
+    }
+    uint8x16_t tbl[4];
+    for (int b = 0; b < 4; b++) tbl[b] = vld1q_u8(planes[b]);
+    const uint8x16_t mask = vdupq_n_u8(0x03);
+    
+    int i = 0;
+    for (; i + 16 <= count; i += 16) {
+        uint8x16_t idx = vandq_u8(vld1q_u8(src + i), mask);
+        uint8x16x4_t px;
+        for (int b = 0; b < 4; b++) px.val[b] = vqtbl1q_u8(tbl[b], idx);
+        vst4q_u8((uint8_t*)(dst + i), px);
+    }
+    lut32_scalar(dst + i, src + i, count - i, pal);
+}
+
+static void lut16_neon(uint16_t* dst, const uint8_t* src, int count, const uint16_t pal[4]) {
+    uint8_t planes[2][16] = {{0}};
+    for (int k = 0; k < 4; k++) {
+        uint8_t bytes[2];
+        memcpy(bytes, &pal[k], 2);
+        planes[0][k] = bytes[0];
+        planes[1][k] = bytes[1];
+    }
+    const uint8x16_t tbl_lo = vld1q_u8(planes[0]);
+    const uint8x16_t tbl_hi = vld1q_u8(planes[1]);
+    const uint8x16_t mask = vdupq_n_u8(0x03);
+    
+    int i = 0;
+    for (; i + 16 <= count; i += 16) {
+        uint8x16_t idx = vandq_u8(vld1q_u8(src + i), mask);
+        uint8x16x2_t px;
+        px.val[0] = vqtbl1q_u8(tbl_lo, idx);
+        px.val[1] = vqtbl1q_u8(tbl_hi, idx);
+        vst2q_u8((uint8_t*)(dst + i), px);
+    }
+    lut16_scalar(dst + i, src + i, count - i, pal);
+}
+#endif
+
+static PaletteLut32Fn palette_lut32 = lut32_scalar;
+static PaletteLut16Fn palette_lut16 = lut16_scalar;
+
+static void init_palette_kernels(void) {
+#if PPU_SIMD_SSE2
+    palette_lut32 = lut32_sse2;
+    palette_lut16 = lut16_sse2;
+#if PPU_SIMD_AVX2
+    if (__builtin_cpu_supports("avx2")) {
+        palette_lut32 = lut32_avx2;
+    }
+#endif
+#elif PPU_SIMD_NEON
+    palette_lut32 = lut32_neon;
+    palette_lut16 = lut16_neon;
+#endif
+}
+
+static uint16_t rgb565(uint32_t argb) {
+    return (uint16_t)((((argb >> 16) & 0xF8) << 8) |
+                      (((argb >> 8) & 0xFC) << 3) |
+                      ((argb & 0xFF) >> 3));
+}
+
+/* ============================================================================
+ * Upscaling
+ *
+ * Filters run on the 2-bit shade indices before palette conversion: a byte
+ * per pixel keeps the kernels 16 pixels wide, equal shades compare exactly,
+ * and every output format reuses the palette kernels above on the wider rows.
+ * ========================================================================== */
+
+#define SCALE_MAX 4
+
+int ppu_scale_factor(GBScaleFilter filter) {
+    switch (filter) {
+        case GB_SCALE_2X:
+        case GB_SCALE_SCALE2X: return 2;
+        case GB_SCALE_3X:      return 3;
+        case GB_SCALE_4X:      return 4;
+        default:               return 1;
+    }
+}
+
+/**
+ * @brief Repeat each index factor times (nearest neighbour, one row)
+ */
+static void expand_row(uint8_t* dst, const uint8_t* src, int factor) {
+    int i = 0;
+#if PPU_SIMD_SSE2
+    if (factor == 2 || factor == 4) {
+        for (; i + 16 <= GB_SCREEN_WIDTH; i += 16) {
+            __m128i v = _mm_loadu_si128((const __m128i*)(src + i));
+            __m128i lo = _mm_unpacklo_epi8(v, v);
+            __m128i hi = _mm_unpackhi_epi8(v, v);
+            if (factor == 2) {
+                _mm_storeu_si128((__m128i*)(dst + i * 2), lo);
+                _mm_storeu_si128((__m128i*)(dst + i * 2 + 16), hi);
+            } else {
+                uint8_t* out = dst + i * 4;
+                _mm_storeu_si128((__m128i*)(out), _mm_unpacklo_epi8(lo, lo));
+                _mm_storeu_si128((__m128i*)(out + 16), _mm_unpackhi_epi8(lo, lo));
+                _mm_storeu_si128((__m128i*)(out + 32), _mm_unpacklo_epi8(hi, hi));
+                _mm_storeu_si128((__m128i*)(out + 48), _mm_unpackhi_epi8(hi, hi));
+            }
+        }
+    } else if (factor == 3) {
+        /* No byte shuffle in SSE2: build each 12-byte group of four pixels
+           from three little-endian words */
+        for (; i + 4 <= GB_SCREEN_WIDTH; i += 4) {
+            uint32_t w[3] = {
+                src[i] * 0x00010101u | (uint32_t)src[i + 1] << 24,
+                src[i + 1] * 0x0101u | (uint32_t)src[i + 2] * 0x01010000u,
+                src[i + 2] | (uint32_t)src[i + 3] * 0x01010100u,
+            };
+            memcpy(dst + i * 3, w, sizeof(w));
+        }
+    }
+#elif PPU_SIMD_NEON
+    /* Interleaving stores write each lane factor times */
+    for (; i + 16 <= GB_SCREEN_WIDTH; i += 16) {
+        uint8x16_t v = vld1q_u8(src + i);
+        if (factor == 2) {
+            uint8x16x2_t px = { { v, v } };
+            vst2q_u8(dst + i * 2, px);
+        } else if (factor == 3) {
+            uint8x16x3_t px = { { v, v, v } };
+            vst3q_u8(dst + i * 3, px);
+        } else {
+            uint8x16x4_t px = { { v, v, v, v } };
+            vst4q_u8(dst + i * 4, px);
+        }
+    }
+#endif
+    for (; i < GB_SCREEN_WIDTH; i++) {
+        for (int k = 0; k < factor; k++) dst[i * factor + k] = src[i];
+    }
+}
+
+/**
+ * @brief Scale2x (AdvMAME2x) one source row into two output rows
+ *
+ * For center E with neighbours B (above), D (left), F (right), H (below),
+ * when B != H and D != F each quarter takes the neighbour its two adjacent
+ * edges agree on: top-left D if D == B, top-right F if B == F, bottom-left
+ * D if D == H, bottom-right F if H == F. Otherwise all four are E.
+ */
+static void scale2x_row(uint8_t* top, uint8_t* bottom, const uint8_t* above,
+                        const uint8_t* row, const uint8_t* below) {
+    /* Edge pixels are their own outside neighbours */
+    uint8_t pad[GB_SCREEN_WIDTH + 2];
+    pad[0] = row[0];
+    memcpy(pad + 1, row, GB_SCREEN_WIDTH);
+    pad[GB_SCREEN_WIDTH + 1] = row[GB_SCREEN_WIDTH - 1];
     
-    /* Debug: log first scanline render details */
-    if (ppu->ly == 0) {
-        // DBG_PPU("Rendered scanline 0 - LCDC=0x%02X, BGP=0x%02X, SCX=%d, SCY=%d",
-        //        ppu->lcdc, ppu->bgp, ppu->scx, ppu->scy);
+    int i = 0;
+#if PPU_SIMD_SSE2
+    for (; i + 16 <= GB_SCREEN_WIDTH; i += 16) {
+        __m128i b = _mm_loadu_si128((const __m128i*)(above + i));
+        __m128i h = _mm_loadu_si128((const __m128i*)(below + i));
+        __m128i d = _mm_loadu_si128((const __m128i*)(pad + i));
+        __m128i e = _mm_loadu_si128((const __m128i*)(pad + i + 1));
+        __m128i f = _mm_loadu_si128((const __m128i*)(pad + i + 2));
+        /* Lanes where the rule applies at all: B != H && D != F */
+        __m128i active = _mm_andnot_si128(_mm_or_si128(_mm_cmpeq_epi8(b, h), _mm_cmpeq_epi8(d, f)),
+                                          _mm_set1_epi8(-1));
+        __m128i m0 = _mm_and_si128(active, _mm_cmpeq_epi8(d, b));
+        __m128i m1 = _mm_and_si128(active, _mm_cmpeq_epi8(b, f));
+        __m128i m2 = _mm_and_si128(active, _mm_cmpeq_epi8(d, h));
+        __m128i m3 = _mm_and_si128(active, _mm_cmpeq_epi8(h, f));
+        __m128i e0 = _mm_or_si128(_mm_and_si128(m0, d), _mm_andnot_si128(m0, e));
+        __m128i e1 = _mm_or_si128(_mm_and_si128(m1, f), _mm_andnot_si128(m1, e));
+        __m128i e2 = _mm_or_si128(_mm_and_si128(m2, d), _mm_andnot_si128(m2, e));
+        __m128i e3 = _mm_or_si128(_mm_and_si128(m3, f), _mm_andnot_si128(m3, e));
+        _mm_storeu_si128((__m128i*)(top + i * 2), _mm_unpacklo_epi8(e0, e1));
+        _mm_storeu_si128((__m128i*)(top + i * 2 + 16), _mm_unpackhi_epi8(e0, e1));
+        _mm_storeu_si128((__m128i*)(bottom + i * 2), _mm_unpacklo_epi8(e2, e3));
+        _mm_storeu_si128((__m128i*)(bottom + i * 2 + 16), _mm_unpackhi_epi8(e2, e3));
+    }
+#elif PPU_SIMD_NEON
+    for (; i + 16 <= GB_SCREEN_WIDTH; i += 16) {
+        uint8x16_t b = vld1q_u8(above + i);
+        uint8x16_t h = vld1q_u8(below + i);
+        uint8x16_t d = vld1q_u8(pad + i);
+        uint8x16_t e = vld1q_u8(pad + i + 1);
+        uint8x16_t f = vld1q_u8(pad + i + 2);
+        uint8x16_t active = vmvnq_u8(vorrq_u8(vceqq_u8(b, h), vceqq_u8(d, f)));
+        uint8x16x2_t up, down;
+        up.val[0] = vbslq_u8(vandq_u8(active, vceqq_u8(d, b)), d, e);
+        up.val[1] = vbslq_u8(vandq_u8(active, vceqq_u8(b, f)), f, e);
+        down.val[0] = vbslq_u8(vandq_u8(active, vceqq_u8(d, h)), d, e);
+        down.val[1] = vbslq_u8(vandq_u8(active, vceqq_u8(h, f)), f, e);
+        vst2q_u8(top + i * 2, up);
+        vst2q_u8(bottom + i * 2, down);
+    }
+#else
+    /* Scalar build; the vector loops need no tail as 160 is a multiple of 16 */
+    for (; i < GB_SCREEN_WIDTH; i++) {
+        uint8_t b = above[i], h = below[i], d = pad[i], e = pad[i + 1], f = pad[i + 2];
+        bool active = b != h && d != f;
+        top[i * 2]        = (active && d == b) ? d : e;
+        top[i * 2 + 1]    = (active && b == f) ? f : e;
+        bottom[i * 2]     = (active && d == h) ? d : e;
+        bottom[i * 2 + 1] = (active && h == f) ? f : e;
+    }
+#endif
+}
+
+/* ============================================================================
+ * Output Conversion
+ * ========================================================================== */
+
+static void convert_row(void* row, const uint8_t* src, int count, GBPixelFormat format,
+                        const uint32_t pal32[4], const uint16_t pal16[4]) {
+    switch (format) {
+        case GB_PIXEL_ARGB8888:
+        case GB_PIXEL_RGBA8888:
+            palette_lut32((uint32_t*)row, src, count, pal32);
+            break;
+        case GB_PIXEL_RGB565:
+            palette_lut16((uint16_t*)row, src, count, pal16);
+            break;
+        case GB_PIXEL_INDEXED:
+            memcpy(row, src, (size_t)count);
+            break;
     }
 }
 
+void ppu_convert_frame(const GBPPU* ppu, void* pixels, GBPixelFormat format, size_t pitch) {
+    ppu_convert_frame_scaled(ppu, pixels, format, pitch, GB_SCALE_NONE);
+}
+
+void ppu_convert_frame_scaled(const GBPPU* ppu, void* pixels, GBPixelFormat format, size_t pitch,
+                              GBScaleFilter filter) {
+    uint32_t pal32[4];
+    uint16_t pal16[4];
+    size_t bpp = 4;
+    
+    switch (format) {
+        case GB_PIXEL_ARGB8888:
+            memcpy(pal32, dmg_palette, sizeof(pal32));
+            break;
+        case GB_PIXEL_RGBA8888:
+            for (int k = 0; k < 4; k++) {
+                uint8_t rgba[4] = {
+                    (uint8_t)(dmg_palette[k] >> 16), (uint8_t)(dmg_palette[k] >> 8),
+                    (uint8_t)dmg_palette[k], (uint8_t)(dmg_palette[k] >> 24)
+                };
+                memcpy(&pal32[k], rgba, 4);
+            }
+            break;
+        case GB_PIXEL_RGB565:
+            bpp = 2;
+            for (int k = 0; k < 4; k++) pal16[k] = rgb565(dmg_palette[k]);
+            break;
+        case GB_PIXEL_INDEXED:
+            bpp = 1;
+            break;
+    }
+    
+    int factor = ppu_scale_factor(filter);
+    int width = GB_SCREEN_WIDTH * factor;
+    size_t row_bytes = (size_t)width * bpp;
+    if (pitch == 0) pitch = row_bytes;
+    
+    uint8_t wide[2][GB_SCREEN_WIDTH * SCALE_MAX];
+    for (int y = 0; y < GB_SCREEN_HEIGHT; y++) {
+        const uint8_t* src = &ppu->framebuffer[y * GB_SCREEN_WIDTH];
+        uint8_t* row = (uint8_t*)pixels + (size_t)y * factor * pitch;
+        
+        if (filter == GB_SCALE_SCALE2X) {
+            const uint8_t* above = y > 0 ? src - GB_SCREEN_WIDTH : src;
+            const uint8_t* below = y < GB_SCREEN_HEIGHT - 1 ? src + GB_SCREEN_WIDTH : src;
+            scale2x_row(wide[0], wide[1], above, src, below);
+            convert_row(row, wide[0], width, format, pal32, pal16);
+            convert_row(row + pitch, wide[1], width, format, pal32, pal16);
+        } else if (factor > 1) {
+            /* Convert one row, then repeat it */
+            expand_row(wide[0], src, factor);
+            convert_row(row, wide[0], width, format, pal32, pal16);
+            for (int k = 1; k < factor; k++) memcpy(row + k * pitch, row, row_bytes);
+        } else {
+            convert_row(row, src, width, format, pal32, pal16);
+        }
+    }
+}
+
+void ppu_set_output_buffer(GBPPU* ppu, void* pixels, GBPixelFormat format, size_t pitch) {
+    ppu->out_pixels = pixels;
+    ppu->out_format = format;
+    ppu->out_pitch = pitch;
+    ppu->out_stale = true;  /* New target needs a full conversion */
+}
+
+void ppu_set_output_scale(GBPPU* ppu, GBScaleFilter filter) {
+    ppu->out_scale = filter;
+    ppu->out_stale = true;
+}
+
 /**
  * @brief Convert framebuffer to RGB
  */
 static void convert_to_rgb(GBPPU* ppu) {
-    /* Debug: check if framebuffer has any non-zero pixels */
-    static int convert_count = 0;
-    bool has_content = dbg_has_nonzero_pixels(ppu->framebuffer, GB_FRAMEBUFFER_SIZE);
-    
-    for (int i = 0; i < GB_FRAMEBUFFER_SIZE; i++) {
-        ppu->rgb_framebuffer[i] = dmg_palette[ppu->framebuffer[i] & 0x03];
+    if (ppu->out_pixels) {
+        ppu_convert_frame_scaled(ppu, ppu->out_pixels, ppu->out_format, ppu->out_pitch, ppu->out_scale);
+    } else {
+        palette_lut32(ppu->rgb_framebuffer, ppu->framebuffer, GB_FRAMEBUFFER_SIZE, dmg_palette);
     }
     
+#ifdef GB_DEBUG_FRAME
+    /* Debug: check if framebuffer has any non-zero pixels */
+    static int convert_count = 0;
     convert_count++;
     if (convert_count <= 5 || (convert_count % 60 == 0)) {
+        bool has_content = dbg_has_nonzero_pixels(ppu->framebuffer, GB_FRAMEBUFFER_SIZE);
         DBG_FRAME("Frame %d converted to RGB - has_content=%d", convert_count, has_content);
         dbg_dump_framebuffer(ppu->framebuffer, GB_SCREEN_WIDTH);
     }
+#endif
+}
+
+/**
+ * @brief Close out a frame: record whether it changed and convert it if so
+ */
+static void finish_frame(GBPPU* ppu) {
+    ppu->frame_changed = ppu->frame_dirty;
+    ppu->frame_dirty = false;
+    if (ppu->frame_changed || ppu->out_stale) {
+        convert_to_rgb(ppu);
+        ppu->out_stale = false;
+    }
 }
 
 /* ============================================================================
  * PPU Mode State Machine
  * ========================================================================== */
 
+/**
+ * @brief Decide whether the frame that is starting gets drawn
+ */
+static void begin_frame(GBPPU* ppu) {
+    bool skip = ppu->headless || ppu->skip_next;
+    
+    if (ppu->skip_period) {
+        skip |= ppu->skip_phase >= ppu->skip_period - ppu->skip_count;
+        ppu->skip_phase = (ppu->skip_phase + 1) % ppu->skip_period;
+    }
+    ppu->skip_next = false;
+    ppu->render_frame = !skip;
+}
+
+void ppu_set_frameskip(GBPPU* ppu, uint32_t skip, uint32_t period) {
+    if (skip == 0 || period == 0) {
+        ppu->skip_count = 0;
+        ppu->skip_period = 0;
+    } else {
+        /* Always draw at least one frame per period */
+        ppu->skip_period = period;
+        ppu->skip_count = (skip < period) ? skip : period - 1;
+    }
+    ppu->skip_phase = 0;
+}
+
+void ppu_skip_next_frame(GBPPU* ppu) {
+    ppu->skip_next = true;
+}
+
+void ppu_set_headless(GBPPU* ppu, bool headless) {
+    ppu->headless = headless;
+    if (headless) ppu->render_frame = false;
+}
+
 /**
  * @brief Update STAT register mode bits
  */
@@ -379,11 +1073,21 @@ void ppu_tick(GBPPU* ppu, GBContext* ctx, uint32_t cycles) {
                     /* Enter VBlank */
                     ppu->mode = PPU_MODE_VBLANK;
                     
-                    /* Convert framebuffer to RGB - only if not already ready */
+                    /* Convert framebuffer to RGB - only if not already ready,
+                       and only if some line actually changed */
+                    if (ppu->deferred) {
+                        /* The log is handed off every frame, consumed or not */
+                        deferred_submit_frame(ppu);
+                    }
                     if (!ppu->frame_ready) {
-                        convert_to_rgb(ppu);
+                        if (!ppu->deferred) {
+                            finish_frame(ppu);
+                        }
                         ppu->frame_ready = true;
                         ctx->frame_done = 1;
+                        if (ctx->callbacks.on_vblank) {
+                            ctx->callbacks.on_vblank(ctx, ppu->framebuffer);
+                        }
                     }
                     
                     /* Request VBlank interrupt (IF bit 0) */
@@ -408,6 +1112,7 @@ void ppu_tick(GBPPU* ppu, GBContext* ctx, uint32_t cycles) {
                     ppu->window_line = 0;
                     ppu->window_triggered = false;
                     ppu->mode = PPU_MODE_OAM;
+                    begin_frame(ppu);
                 }
                 
                 update_stat(ppu, ctx);
@@ -469,6 +1174,9 @@ void ppu_write_register(GBPPU* ppu, GBContext* ctx, uint16_t addr, uint8_t value
                 ppu->frame_ready = false;
                 DBG_REGS("LCD turned OFF - reset LY to 0");
             }
+            if ((ppu->lcdc ^ value) & LCDC_OBJ_SIZE) {
+                ppu->sprite_lists_dirty = true;
+            }
             ppu->lcdc = value;
             break;
         case 0xFF41:
@@ -494,6 +1202,7 @@ void ppu_write_register(GBPPU* ppu, GBContext* ctx, uint16_t addr, uint8_t value
                 for (int i = 0; i < OAM_SIZE; i++) {
                     ctx->oam[i] = gb_read8(ctx, src + i);
                 }
+                ppu->sprite_lists_dirty = true;
             }
             break;
         case 0xFF47: 
@@ -523,6 +1232,356 @@ void ppu_clear_frame_ready(GBPPU* ppu) {
     ppu->frame_ready = false;
 }
 
+bool ppu_frame_changed(GBPPU* ppu) {
+    return ppu->frame_changed;
+}
+
 const uint32_t* ppu_get_framebuffer(GBPPU* ppu) {
-    return ppu->rgb_framebuffer;
+    if (!ppu->out_pixels) return ppu->rgb_framebuffer;
+    if (ppu->out_format == GB_PIXEL_ARGB8888 && ppu->out_scale == GB_SCALE_NONE &&
+        (ppu->out_pitch == 0 || ppu->out_pitch == GB_SCREEN_WIDTH * sizeof(uint32_t))) {
+        return (const uint32_t*)ppu->out_pixels;
+    }
+    /* Frames go to an output buffer of another shape; rgb_framebuffer is stale */
+    return NULL;
+}
+
+/* ============================================================================
+ * Save State
+ * ========================================================================== */
+
+void ppu_serialize(GBPPU* ppu, GBContext* ctx, GBStateCursor* c) {
+    /* A restarted worker picks up the loaded state */
+    bool restart = c->load && c->pos && ppu->deferred;
+    if (restart) ppu_set_deferred(ppu, ctx, false);
+
+    GB_STATE_FIELD(c, ppu->lcdc);
+    GB_STATE_FIELD(c, ppu->stat);
+    GB_STATE_FIELD(c, ppu->scy);
+    GB_STATE_FIELD(c, ppu->scx);
+    GB_STATE_FIELD(c, ppu->ly);
+    GB_STATE_FIELD(c, ppu->lyc);
+    GB_STATE_FIELD(c, ppu->dma);
+    GB_STATE_FIELD(c, ppu->bgp);
+    GB_STATE_FIELD(c, ppu->obp0);
+    GB_STATE_FIELD(c, ppu->obp1);
+    GB_STATE_FIELD(c, ppu->wy);
+    GB_STATE_FIELD(c, ppu->wx);
+    GB_STATE_FIELD(c, ppu->stat_irq_state);
+    GB_STATE_FIELD(c, ppu->mode);
+    GB_STATE_FIELD(c, ppu->mode_cycles);
+    GB_STATE_FIELD(c, ppu->window_line);
+    GB_STATE_FIELD(c, ppu->window_triggered);
+    GB_STATE_FIELD(c, ppu->frame_ready);
+    if (c->rollback && c->load) {
+        gb_state_skip(c, sizeof(ppu->framebuffer));
+    } else {
+        GB_STATE_FIELD(c, ppu->framebuffer);
+    }
+
+    if (!c->load || !c->pos) return;
+
+    ppu->sprite_lists_dirty = true;
+    if (c->rollback && !restart) {
+        /* The tile cache followed VRAM as it was rolled back, and the line
+           keys still describe the framebuffer that was kept */
+        return;
+    }
+
+    /* Caches and line keys describe the old VRAM; rebuild them */
+    ppu_rebuild_tile_cache(ppu, ctx->vram);
+    memset(ppu->line_keys, 0, sizeof(ppu->line_keys));
+    if (!c->rollback) {
+        ppu->frame_dirty = true;
+        ppu->frame_changed = true;
+        ppu->out_stale = true;
+    }
+
+    if (restart) ppu_set_deferred(ppu, ctx, true);
+}
+
+void ppu_refresh_output(GBPPU* ppu) {
+    if (ppu->headless) return;
+    convert_to_rgb(ppu);
+    ppu->out_stale = false;
+}
+
+/* ============================================================================
+ * Deferred Rendering
+ *
+ * The emulation thread only records what each visible line is drawn from:
+ * the LCD registers and window line when the line is reached, VRAM byte
+ * changes in order, and an OAM snapshot whenever OAM changed. At VBlank the
+ * log is handed to a worker thread that replays it against its own copy of
+ * VRAM/OAM and a shadow GBPPU, so raster effects and mid-frame VRAM updates
+ * land on the same lines as inline rendering. The CPU runs the next frame
+ * meanwhile; the finished frame is published at the following VBlank, one
+ * frame behind emulation.
+ * ========================================================================== */
+
+typedef struct {
+    uint8_t lcdc, scx, scy, wx, wy, bgp, obp0, obp1;
+    uint8_t ly;
+    uint8_t window_line;
+    int16_t oam_snapshot;     /* Index into oam_snapshots, or -1 if unchanged */
+    uint32_t vram_end;        /* VRAM deltas to apply before drawing this line */
+} PPULineRecord;
+
+typedef struct {
+    uint16_t addr;            /* bank * VRAM_SIZE + offset */
+    uint8_t value;
+} PPUVramDelta;
+
+typedef struct {
+    PPULineRecord lines[VISIBLE_SCANLINES];
+    uint32_t line_count;
+    uint8_t oam_snapshots[VISIBLE_SCANLINES][OAM_SIZE];
+    uint32_t oam_count;
+    PPUVramDelta* vram;
+    uint32_t vram_count;
+    uint32_t vram_capacity;
+} PPUFrameLog;
+
+struct PPUDeferred {
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    bool busy;                /* Worker is replaying logs[1 - record] */
+    bool quit;
+    bool result_changed;      /* Shadow frame changed since last published */
+    
+    PPUFrameLog logs[2];
+    int record;               /* Log the emulation thread is filling */
+    
+    /* Owned by the worker while busy */
+    GBPPU shadow;
+    uint8_t vram[VRAM_SIZE * 2];
+    uint8_t oam[OAM_SIZE];
+};
+
+/**
+ * @return false if the log could not grow and the write was not recorded
+ */
+static bool deferred_log_vram(GBPPU* ppu, uint16_t addr, uint8_t value) {
+    PPUFrameLog* log = &ppu->deferred->logs[ppu->deferred->record];
+    
+    if (log->vram_count == log->vram_capacity) {
+        uint32_t capacity = log->vram_capacity ? log->vram_capacity * 2 : 4096;
+        PPUVramDelta* grown = (PPUVramDelta*)realloc(log->vram, capacity * sizeof(PPUVramDelta));
+        if (!grown) {
+            fprintf(stderr, "[PPU] Out of memory growing deferred VRAM log, rendering inline\n");
+            return false;
+        }
+        log->vram = grown;
+        log->vram_capacity = capacity;
+    }
+    log->vram[log->vram_count].addr = addr;
+    log->vram[log->vram_count].value = value;
+    log->vram_count++;
+    return true;
+}
+
+static void deferred_log_line(GBPPU* ppu, GBContext* ctx) {
+    PPUDeferred* d = ppu->deferred;
+    PPUFrameLog* log = &d->logs[d->record];
+    
+    if (log->line_count == VISIBLE_SCANLINES) {
+        /* LCD was restarted mid-frame; hand off what we have */
+        deferred_submit_frame(ppu);
+        log = &d->logs[d->record];
+    }
+    
+    PPULineRecord* rec = &log->lines[log->line_count++];
+    rec->lcdc = ppu->lcdc;
+    rec->scx = ppu->scx;
+    rec->scy = ppu->scy;
+    rec->wx = ppu->wx;
+    rec->wy = ppu->wy;
+    rec->bgp = ppu->bgp;
+    rec->obp0 = ppu->obp0;
+    rec->obp1 = ppu->obp1;
+    rec->ly = ppu->ly;
+    rec->window_line = ppu->window_line;
+    rec->vram_end = log->vram_count;
+    rec->oam_snapshot = -1;
+    
+    /* sprite_lists_dirty is set on every OAM change, so on this side it
+       doubles as "OAM changed since the last snapshot" */
+    if (ppu->sprite_lists_dirty) {
+        rec->oam_snapshot = (int16_t)log->oam_count;
+        memcpy(log->oam_snapshots[log->oam_count++], ctx->oam, OAM_SIZE);
+        ppu->sprite_lists_dirty = false;
+    }
+    
+    /* The window line counter is the only render state carried across lines */
+    advance_window_line(ppu);
+}
+
+static void deferred_apply_vram(PPUDeferred* d, const PPUVramDelta* delta) {
+    d->vram[delta->addr] = delta->value;
+    ppu_vram_write(&d->shadow, d->vram, delta->addr / VRAM_SIZE, delta->addr % VRAM_SIZE);
+}
+
+/**
+ * @brief Render a frame log on the worker's private state
+ */
+static void deferred_replay(PPUDeferred* d, const PPUFrameLog* log) {
+    GBPPU* shadow = &d->shadow;
+    uint32_t applied = 0;
+    
+    for (uint32_t i = 0; i < log->line_count; i++) {
+        const PPULineRecord* rec = &log->lines[i];
+        
+        for (; applied < rec->vram_end; applied++) {
+            deferred_apply_vram(d, &log->vram[applied]);
+        }
+        if (rec->oam_snapshot >= 0) {
+            memcpy(d->oam, log->oam_snapshots[rec->oam_snapshot], OAM_SIZE);
+            shadow->sprite_lists_dirty = true;
+        }
+        if ((shadow->lcdc ^ rec->lcdc) & LCDC_OBJ_SIZE) {
+            shadow->sprite_lists_dirty = true;
+        }
+        
+        shadow->lcdc = rec->lcdc;
+        shadow->scx = rec->scx;
+        shadow->scy = rec->scy;
+        shadow->wx = rec->wx;
+        shadow->wy = rec->wy;
+        shadow->bgp = rec->bgp;
+        shadow->obp0 = rec->obp0;
+        shadow->obp1 = rec->obp1;
+        shadow->ly = rec->ly;
+        shadow->window_line = rec->window_line;
+        render_line(shadow, d->vram, d->oam);
+    }
+    
+    /* Writes after the last visible line belong to VBlank */
+    for (; applied < log->vram_count; applied++) {
+        deferred_apply_vram(d, &log->vram[applied]);
+    }
+    
+    finish_frame(shadow);
+}
+
+static void* deferred_worker(void* arg) {
+    PPUDeferred* d = (PPUDeferred*)arg;
+    
+    pthread_mutex_lock(&d->lock);
+    for (;;) {
+        while (!d->busy && !d->quit) {
+            pthread_cond_wait(&d->cond, &d->lock);
+        }
+        if (d->quit) break;
+        
+        const PPUFrameLog* log = &d->logs[1 - d->record];
+        pthread_mutex_unlock(&d->lock);
+        deferred_replay(d, log);
+        pthread_mutex_lock(&d->lock);
+        
+        d->result_changed |= d->shadow.frame_changed;
+        d->busy = false;
+        pthread_cond_broadcast(&d->cond);
+    }
+    pthread_mutex_unlock(&d->lock);
+    return NULL;
+}
+
+/**
+ * @brief Publish the worker's last frame and hand it the log just recorded
+ */
+static void deferred_submit_frame(GBPPU* ppu) {
+    PPUDeferred* d = ppu->deferred;
+    
+    pthread_mutex_lock(&d->lock);
+    while (d->busy) {
+        pthread_cond_wait(&d->cond, &d->lock);
+    }
+    
+    ppu->frame_changed = d->result_changed;
+    if (d->result_changed) {
+        memcpy(ppu->framebuffer, d->shadow.framebuffer, sizeof(ppu->framebuffer));
+    }
+    if (d->result_changed || ppu->out_stale) {
+        if (ppu->out_pixels) {
+            ppu_convert_frame_scaled(ppu, ppu->out_pixels, ppu->out_format, ppu->out_pitch, ppu->out_scale);
+        } else {
+            memcpy(ppu->rgb_framebuffer, d->shadow.rgb_framebuffer, sizeof(ppu->rgb_framebuffer));
+        }
+        ppu->out_stale = false;
+        d->result_changed = false;
+    }
+    
+    d->record = 1 - d->record;
+    PPUFrameLog* next = &d->logs[d->record];
+    next->line_count = 0;
+    next->oam_count = 0;
+    next->vram_count = 0;
+    
+    d->busy = true;
+    pthread_cond_broadcast(&d->cond);
+    pthread_mutex_unlock(&d->lock);
+}
+
+bool ppu_set_deferred(GBPPU* ppu, GBContext* ctx, bool enabled) {
+    if (enabled == (ppu->deferred != NULL)) return true;
+    
+    if (enabled) {
+        PPUDeferred* d = (PPUDeferred*)calloc(1, sizeof(PPUDeferred));
+        if (!d) return false;
+        
+        /* The worker starts from the inline renderer's state */
+        d->shadow = *ppu;
+        d->shadow.deferred = NULL;
+        d->shadow.out_pixels = NULL;
+        memcpy(d->vram, ctx->vram, sizeof(d->vram));
+        memcpy(d->oam, ctx->oam, sizeof(d->oam));
+        
+        pthread_mutex_init(&d->lock, NULL);
+        pthread_cond_init(&d->cond, NULL);
+        if (pthread_create(&d->thread, NULL, deferred_worker, d) != 0) {
+            fprintf(stderr, "[PPU] Failed to start render thread, rendering inline\n");
+            pthread_cond_destroy(&d->cond);
+            pthread_mutex_destroy(&d->lock);
+            free(d);
+            return false;
+        }
+        
+        ppu->sprite_lists_dirty = false;
+        ppu->deferred = d;
+        DBG_PPU("Deferred rendering enabled");
+        return true;
+    }
+    
+    deferred_stop(ppu, ctx->vram);
+    return true;
+}
+
+/**
+ * @brief Stop the worker and go back to inline rendering from live VRAM
+ */
+static void deferred_stop(GBPPU* ppu, const uint8_t* vram) {
+    PPUDeferred* d = ppu->deferred;
+    pthread_mutex_lock(&d->lock);
+    while (d->busy) {
+        pthread_cond_wait(&d->cond, &d->lock);
+    }
+    d->quit = true;
+    pthread_cond_broadcast(&d->cond);
+    pthread_mutex_unlock(&d->lock);
+    pthread_join(d->thread, NULL);
+    
+    pthread_cond_destroy(&d->cond);
+    pthread_mutex_destroy(&d->lock);
+    free(d->logs[0].vram);
+    free(d->logs[1].vram);
+    free(d);
+    ppu->deferred = NULL;
+    
+    /* The inline caches went stale while deferred; rebuild from live VRAM */
+    ppu_rebuild_tile_cache(ppu, vram);
+    memset(ppu->line_keys, 0, sizeof(ppu->line_keys));
+    ppu->sprite_lists_dirty = true;
+    ppu->frame_dirty = true;
+    DBG_PPU("Deferred rendering disabled");
 }
@@ -0,0 +1,386 @@
+/**
+ * @file savestate.c
+ * @brief Machine state snapshots and the rewind buffer
+ */
+
+#include "savestate.h"
+#include "ppu.h"
+#include "audio.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+/* ============================================================================
+ * Save States
+ * ========================================================================== */
+
+typedef struct {
+    uint32_t magic;      /* GB_STATE_MAGIC */
+    uint32_t version;    /* GB_STATE_VERSION */
+    uint32_t size;       /* Whole state including this header */
+    uint32_t eram_size;  /* Cartridge RAM included */
+} StateHeader;
+
+/**
+ * @brief Visit every module's state in a fixed order
+ *
+ * Memory comes before the PPU so a load can rebuild the tile cache from
+ * the restored VRAM.
+ */
+static size_t serialize(GBContext* ctx, uint8_t* pos, bool load, bool rollback) {
+    GBStateCursor c = { pos, 0, load, rollback };
+    gb_context_serialize(ctx, &c);
+    if (ctx->ppu) ppu_serialize((GBPPU*)ctx->ppu, ctx, &c);
+    gb_audio_serialize(ctx, &c);
+    return c.size;
+}
+
+size_t gb_state_size(GBContext* ctx) {
+    return sizeof(StateHeader) + serialize(ctx, NULL, false, false);
+}
+
+bool gb_state_save(GBContext* ctx, void* buffer, size_t size) {
+    size_t needed = gb_state_size(ctx);
+    if (size < needed) return false;
+
+    StateHeader header;
+    header.magic = GB_STATE_MAGIC;
+    header.version = GB_STATE_VERSION;
+    header.size = (uint32_t)needed;
+    header.eram_size = (uint32_t)ctx->eram_size;
+    memcpy(buffer, &header, sizeof(header));
+
+    serialize(ctx, (uint8_t*)buffer + sizeof(header), false, false);
+    return true;
+}
+
+static bool load_state(GBContext* ctx, const void* buffer, size_t size, bool rollback) {
+    StateHeader header;
+    if (size < sizeof(header)) return false;
+    memcpy(&header, buffer, sizeof(header));
+
+    if (header.magic != GB_STATE_MAGIC || header.version != GB_STATE_VERSION) return false;
+    if (header.eram_size != ctx->eram_size || header.size != size ||
+        size != gb_state_size(ctx)) {
+        return false;
+    }
+
+    /* Only read from: the cursor copies out of the buffer when loading */
+    serialize(ctx, (uint8_t*)buffer + sizeof(header), true, rollback);
+    return true;
+}
+
+bool gb_state_load(GBContext* ctx, const void* buffer, size_t size) {
+    if (!load_state(ctx, buffer, size, false)) return false;
+    if (ctx->ppu) ppu_refresh_output((GBPPU*)ctx->ppu);
+    return true;
+}
+
+bool gb_state_rollback(GBContext* ctx, const void* buffer, size_t size) {
+    return load_state(ctx, buffer, size, true);
+}
+
+bool gb_state_save_file(GBContext* ctx, const char* path) {
+    size_t size = gb_state_size(ctx);
+    uint8_t* buffer = (uint8_t*)malloc(size);
+    if (!buffer) return false;
+
+    gb_state_save(ctx, buffer, size);
+    FILE* f = fopen(path, "wb");
+    bool ok = f && fwrite(buffer, 1, size, f) == size;
+    if (f && fclose(f) != 0) ok = false;
+    free(buffer);
+
+    if (!ok) fprintf(stderr, "[STATE] Cannot write %s\n", path);
+    return ok;
+}
+
+bool gb_state_load_file(GBContext* ctx, const char* path) {
+    FILE* f = fopen(path, "rb");
+    if (!f) {
+        fprintf(stderr, "[STATE] Cannot open %s\n", path);
+        return false;
+    }
+
+    size_t size = gb_state_size(ctx);
+    uint8_t* buffer = (uint8_t*)malloc(size + 1);
+    /* Read one byte more than expected to catch oversized files */
+    size_t got = buffer ? fread(buffer, 1, size + 1, f) : 0;
+    fclose(f);
+
+    bool ok = buffer && gb_state_load(ctx, buffer, got);
+    free(buffer);
+    if (!ok) fprintf(stderr, "[STATE] %s is not a state for this cartridge and version\n", path);
+    return ok;
+}
+
+/* ============================================================================
+ * Rewind
+ *
+ * Entries are stored oldest first. Encoding is a sequence of
+ * (zero run length, literal length, literal bytes) with LEB128 lengths.
+ * The encoder scans 8-byte words, so zero runs that don't cover a whole
+ * word stay inside the literals. A delta entry encodes the state XORed with
+ * its group's keyframe, so it can be decoded once that keyframe is; the
+ * decoded keyframe of the newest group is kept in key.
+ * ========================================================================== */
+
+#define RLE_WORD 8
+#define REWIND_DEFAULT_INTERVAL 60
+
+typedef struct {
+    uint8_t* data;        /* Encoded state */
+    size_t size;
+    bool keyframe;
+} RewindEntry;
+
+struct GBRewind {
+    size_t state_size;
+    size_t max_bytes;
+    uint32_t interval;
+
+    RewindEntry* entries;
+    size_t count;
+    size_t capacity;
+    size_t used;          /* Sum of encoded sizes */
+
+    uint8_t* state;       /* Raw state being pushed or restored */
+    uint8_t* scratch;     /* Encoder output */
+    uint8_t* key;         /* Raw keyframe of the newest group, if key_valid */
+    bool key_valid;
+    uint32_t since_key;   /* Deltas stored after the newest keyframe */
+};
+
+static size_t put_varint(uint8_t* out, size_t value) {
+    size_t n = 0;
+    while (value >= 0x80) {
+        out[n++] = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    out[n++] = (uint8_t)value;
+    return n;
+}
+
+static bool get_varint(const uint8_t* in, size_t len, size_t* pos, size_t* value) {
+    size_t result = 0;
+    for (int shift = 0; *pos < len && shift < 64; shift += 7) {
+        uint8_t byte = in[(*pos)++];
+        result |= (size_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            *value = result;
+            return true;
+        }
+    }
+    return false;
+}
+
+static inline uint64_t load_word(const uint8_t* p) {
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint64_t xor_word(const uint8_t* in, const uint8_t* base, size_t i) {
+    return base ? load_word(in + i) ^ load_word(base + i) : load_word(in + i);
+}
+
+static void xor_bytes(uint8_t* dst, const uint8_t* a, const uint8_t* b, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        dst[i] = a[i] ^ b[i];
+    }
+}
+
+/**
+ * @brief Encode in XOR base (base NULL: in itself); out needs rle_bound(n)
+ */
+static size_t rle_encode(const uint8_t* in, const uint8_t* base, size_t n, uint8_t* out) {
+    size_t i = 0, o = 0;
+
+    while (i < n) {
+        size_t start = i;
+        while (i + RLE_WORD <= n && xor_word(in, base, i) == 0) i += RLE_WORD;
+        while (i < n && (in[i] ^ (base ? base[i] : 0)) == 0) i++;
+        size_t zeros = i - start;
+
+        /* Literal up to the next zero word, less the zero bytes leading
+           into it, or to the end */
+        size_t lit = i;
+        while (lit + RLE_WORD <= n && xor_word(in, base, lit) != 0) lit += RLE_WORD;
+        if (lit + RLE_WORD > n) {
+            lit = n;
+        } else {
+            while (lit > i && (in[lit - 1] ^ (base ? base[lit - 1] : 0)) == 0) lit--;
+        }
+
+        o += put_varint(out + o, zeros);
+        o += put_varint(out + o, lit - i);
+        if (base) {
+            xor_bytes(out + o, in + i, base + i, lit - i);
+        } else {
+            memcpy(out + o, in + i, lit - i);
+        }
+        o += lit - i;
+        i = lit;
+    }
+    return o;
+}
+
+/**
+ * @brief Every pair but the last is followed by a zero run of at least a
+ *        word, and a pair costs at most two 10-byte varints
+ */
+static size_t rle_bound(size_t n) {
+    return n + (n / RLE_WORD + 2) * 20;
+}
+
+/**
+ * @brief Decode into out, XORing with base (base NULL: plain)
+ */
+static bool rle_decode(const uint8_t* in, size_t len, const uint8_t* base, uint8_t* out, size_t n) {
+    size_t i = 0, o = 0;
+
+    while (i < len) {
+        size_t zeros, lit;
+        if (!get_varint(in, len, &i, &zeros) || !get_varint(in, len, &i, &lit)) return false;
+        if (zeros > n - o || lit > n - o - zeros || lit > len - i) return false;
+        if (base) {
+            memcpy(out + o, base + o, zeros);
+            o += zeros;
+            xor_bytes(out + o, in + i, base + o, lit);
+        } else {
+            memset(out + o, 0, zeros);
+            o += zeros;
+            memcpy(out + o, in + i, lit);
+        }
+        o += lit;
+        i += lit;
+    }
+    return o == n;
+}
+
+GBRewind* gb_rewind_create(GBContext* ctx, size_t max_bytes, uint32_t keyframe_interval) {
+    GBRewind* rewind = (GBRewind*)calloc(1, sizeof(GBRewind));
+    if (!rewind) return NULL;
+
+    rewind->state_size = gb_state_size(ctx);
+    rewind->max_bytes = max_bytes;
+    rewind->interval = keyframe_interval ? keyframe_interval : REWIND_DEFAULT_INTERVAL;
+    rewind->state = (uint8_t*)malloc(rewind->state_size);
+    rewind->key = (uint8_t*)malloc(rewind->state_size);
+    rewind->scratch = (uint8_t*)malloc(rle_bound(rewind->state_size));
+
+    if (!rewind->state || !rewind->key || !rewind->scratch) {
+        gb_rewind_destroy(rewind);
+        return NULL;
+    }
+    return rewind;
+}
+
+void gb_rewind_destroy(GBRewind* rewind) {
+    if (!rewind) return;
+    for (size_t i = 0; i < rewind->count; i++) {
+        free(rewind->entries[i].data);
+    }
+    free(rewind->entries);
+    free(rewind->state);
+    free(rewind->key);
+    free(rewind->scratch);
+    free(rewind);
+}
+
+/**
+ * @brief Drop the oldest groups while over budget, always keeping the newest
+ */
+static void rewind_evict(GBRewind* rewind) {
+    while (rewind->used > rewind->max_bytes) {
+        size_t next = 1;
+        while (next < rewind->count && !rewind->entries[next].keyframe) next++;
+        if (next >= rewind->count) break;
+
+        for (size_t i = 0; i < next; i++) {
+            rewind->used -= rewind->entries[i].size;
+            free(rewind->entries[i].data);
+        }
+        rewind->count -= next;
+        memmove(rewind->entries, rewind->entries + next, rewind->count * sizeof(RewindEntry));
+    }
+}
+
+bool gb_rewind_push(GBRewind* rewind, GBContext* ctx) {
+    if (!gb_state_save(ctx, rewind->state, rewind->state_size)) return false;
+
+    if (rewind->count == rewind->capacity) {
+        size_t capacity = rewind->capacity ? rewind->capacity * 2 : 256;
+        RewindEntry* grown = (RewindEntry*)realloc(rewind->entries, capacity * sizeof(RewindEntry));
+        if (!grown) return false;
+        rewind->entries = grown;
+        rewind->capacity = capacity;
+    }
+
+    bool keyframe = !rewind->key_valid || rewind->since_key + 1 >= rewind->interval;
+    size_t size = rle_encode(rewind->state, keyframe ? NULL : rewind->key,
+                             rewind->state_size, rewind->scratch);
+
+    uint8_t* data = (uint8_t*)malloc(size);
+    if (!data) return false;
+    memcpy(data, rewind->scratch, size);
+
+    RewindEntry* entry = &rewind->entries[rewind->count++];
+    entry->data = data;
+    entry->size = size;
+    entry->keyframe = keyframe;
+    rewind->used += size;
+
+    if (keyframe) {
+        /* The state just saved becomes the key; the old key is free */
+        uint8_t* old_key = rewind->key;
+        rewind->key = rewind->state;
+        rewind->state = old_key;
+        rewind->key_valid = true;
+        rewind->since_key = 0;
+    } else {
+        rewind->since_key++;
+    }
+
+    rewind_evict(rewind);
+    return true;
+}
+
+bool gb_rewind_pop(GBRewind* rewind, GBContext* ctx) {
+    if (rewind->count == 0) return false;
+
+    RewindEntry* entry = &rewind->entries[rewind->count - 1];
+    if (!entry->keyframe && !rewind->key_valid) {
+        /* The group's keyframe was popped past; decode it again */
+        size_t k = rewind->count - 1;
+        while (!rewind->entries[k].keyframe) k--;
+        if (!rle_decode(rewind->entries[k].data, rewind->entries[k].size, NULL,
+                        rewind->key, rewind->state_size)) {
+            return false;
+        }
+        rewind->key_valid = true;
+        rewind->since_key = (uint32_t)(rewind->count - 1 - k);
+    }
+    if (!rle_decode(entry->data, entry->size, entry->keyframe ? NULL : rewind->key,
+                    rewind->state, rewind->state_size) ||
+        !gb_state_load(ctx, rewind->state, rewind->state_size)) {
+        return false;
+    }
+
+    rewind->used -= entry->size;
+    free(entry->data);
+    rewind->count--;
+    if (entry->keyframe) {
+        rewind->key_valid = false;
+    } else {
+        rewind->since_key--;
+    }
+    return true;
+}
+
+size_t gb_rewind_count(const GBRewind* rewind) {
+    return rewind->count;
+}
+
+size_t gb_rewind_memory(const GBRewind* rewind) {
+    return rewind->used;
+}